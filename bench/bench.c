@@ -0,0 +1,252 @@
+/**
+ * Kernel benchmarks in CPU cycles, run headless under simavr: make bench
+ *
+ * Timer1 is taken over as a cycle counter(no prescaler, normal mode) after
+ * ros_init(), so there is no system tick: the tick ISR is called by hand when
+ * it's measured. The results are printed to the simavr console as CSV lines
+ * "bench,<name>,<n>,<cycles>", the counter read overhead is subtracted except
+ * for the interrupt latency.
+ */
+#include <avr/io.h>
+#include <avr/sleep.h>
+#include "avr_mcu_section.h"
+#include "ros.h"
+#include "ros_sem.h"
+
+AVR_MCU(F_CPU, "atmega328p");
+// every byte written to GPIOR0 goes to the simavr console
+AVR_MCU_SIMAVR_CONSOLE(&GPIOR0);
+
+// tasks filling the ready queue and the timer queue, priority 2~5
+#define BENCH_TASKS 6
+#define BENCH_TASK_STACK_SIZE 96
+#define BENCH_LOOPS 8
+// cycles between two latency samples, a prime to sample all the code paths
+#define LATENCY_PERIOD 1009
+#define LATENCY_SAMPLES 200
+// never expires during the benchmarks
+#define LONG_DELAY 60000
+
+#define BENCH_PRIORITY 1
+#define PONG_PRIORITY 0
+#define FILLER_PRIORITY(i) (2 + (i) % 4)
+// below the fillers, above the idle task which must never run
+#define BENCH_LOW_PRIORITY 6
+
+#define CYCLES() TCNT1
+
+ROS_TCB bench_tcb;
+ROS_TCB pong_tcb;
+ROS_TCB filler_tcb[BENCH_TASKS];
+uint8_t bench_stack[ROS_DEFAULT_STACK_SIZE];
+uint8_t pong_stack[ROS_DEFAULT_STACK_SIZE];
+uint8_t filler_stack[BENCH_TASKS][BENCH_TASK_STACK_SIZE];
+
+static ROS_SEM ping_sem;
+static ROS_SEM pong_sem;
+// cycle stamps written by the pong task
+static volatile uint16_t pong_wake;
+static volatile uint16_t pong_block;
+// the fillers with index below it sleep one tick, the others LONG_DELAY
+static volatile uint8_t short_sleepers;
+static uint16_t overhead;
+
+static volatile uint16_t latency_min;
+static volatile uint16_t latency_max;
+static volatile uint8_t latency_count;
+
+static void put_char(char c) { GPIOR0 = c; }
+
+static void put_str(const char *s) {
+  while (*s) put_char(*s++);
+}
+
+static void put_u16(uint16_t value) {
+  char buf[6];
+  uint8_t i = 0;
+  do {
+    buf[i++] = '0' + value % 10;
+    value /= 10;
+  } while (value);
+  while (i) put_char(buf[--i]);
+}
+
+static void report(const char *name, uint16_t n, uint16_t cycles) {
+  put_str("bench,");
+  put_str(name);
+  put_char(',');
+  put_u16(n);
+  put_char(',');
+  put_u16(cycles);
+  put_char('\n');
+}
+
+// Timer1 counts CPU cycles, and the tick interrupt is off
+static void cycle_counter_init() {
+  TIMSK1 = 0;
+  TCCR1A = 0;
+  TCCR1B = _BV(CS10);
+  uint16_t start = CYCLES();
+  overhead = CYCLES() - start;
+}
+
+/**
+ * Wait for ping_sem with pong_tcb's higher priority, so every give switches
+ * to it at once. The stamps tell the cost of waking it and blocking it.
+ */
+void pong_task() {
+  while (1) {
+    pong_block = CYCLES();
+    ros_sem_take(&ping_sem, ROS_WAIT_FOREVER);
+    pong_wake = CYCLES();
+    ros_sem_give(&pong_sem);
+  }
+}
+
+void filler_task() {
+  uint8_t index = ros_current_tcb() - filler_tcb;
+  while (1) ros_delay(index < short_sleepers ? 1 : LONG_DELAY);
+}
+
+/**
+ * @brief Context switch by a semaphore: give to a higher priority waiter, and
+ * the waiter blocks again. Both include the semaphore call.
+ */
+static void bench_switch() {
+  uint16_t wake = 0, block = 0;
+  uint8_t i;
+  for (i = 0; i < BENCH_LOOPS; i++) {
+    uint16_t start = CYCLES();
+    ros_sem_give(&ping_sem);
+    uint16_t end = CYCLES();
+    wake += pong_wake - start - overhead;
+    block += end - pong_block - overhead;
+    ros_sem_take(&pong_sem, ROS_NO_WAIT);
+  }
+  report("switch_wake", 0, wake / BENCH_LOOPS);
+  report("switch_block", 0, block / BENCH_LOOPS);
+}
+
+// ros_schedule() when the running task is still the highest
+static uint16_t schedule_cycles() {
+  uint16_t start = CYCLES();
+  ros_schedule();
+  return CYCLES() - start - overhead;
+}
+
+/**
+ * @brief ros_schedule() vs the number of ready tasks below the running one
+ */
+static void bench_schedule() {
+  uint8_t n;
+  for (n = 0; n <= BENCH_TASKS; n++) {
+    if (n > 0) {
+      ros_create_task(&filler_tcb[n - 1], filler_task, FILLER_PRIORITY(n - 1),
+                      filler_stack[n - 1], BENCH_TASK_STACK_SIZE);
+    }
+    report("schedule", n, schedule_cycles());
+  }
+}
+
+// the tick ISR body, without scheduling
+static uint16_t tick_cycles() {
+  CRITICAL_STORE;
+  CRITICAL_START();
+  uint16_t start = CYCLES();
+  ros_int_enter();
+  ros_sys_tick();
+  uint16_t cycles = CYCLES() - start - overhead;
+  // the woken fillers run and sleep again here
+  ros_int_exit();
+  CRITICAL_END();
+  return cycles;
+}
+
+/**
+ * @brief Tick ISR time vs the number of sleepers expiring at this tick, all
+ * BENCH_TASKS fillers are sleeping
+ */
+static void bench_tick() {
+  uint8_t n;
+  CRITICAL_STORE;
+  short_sleepers = BENCH_TASKS;
+  // let the fillers run and sleep, then they run after every tick
+  CRITICAL_START();
+  ros_tcb_set_priority(&bench_tcb, BENCH_LOW_PRIORITY);
+  CRITICAL_END();
+  ros_schedule();
+  n = BENCH_TASKS + 1;
+  while (n--) {
+    short_sleepers = n;
+    // sleepers from the previous round pick up the new delay
+    tick_cycles();
+    report("tick_expire", n, tick_cycles());
+  }
+  // all the fillers sleep LONG_DELAY now, back above them for the rest
+  CRITICAL_START();
+  ros_tcb_set_priority(&bench_tcb, BENCH_PRIORITY);
+  CRITICAL_END();
+}
+
+ISR(TIMER1_COMPB_vect) {
+  uint16_t latency = CYCLES() - OCR1B;
+  if (latency < latency_min) latency_min = latency;
+  if (latency > latency_max) latency_max = latency;
+  if (++latency_count >= LATENCY_SAMPLES) {
+    TIMSK1 = 0;
+  } else {
+    OCR1B += LATENCY_PERIOD;
+  }
+}
+
+/**
+ * @brief From the compare match to the first line of the ISR, while the tasks
+ * keep switching with interrupt disabled in the kernel. The minimum is the
+ * hardware and ISR prologue part, the maximum includes the longest critical
+ * section hit.
+ */
+static void bench_latency() {
+  CRITICAL_STORE;
+  latency_min = UINT16_MAX;
+  latency_max = 0;
+  latency_count = 0;
+  CRITICAL_START();
+  OCR1B = CYCLES() + LATENCY_PERIOD;
+  TIFR1 = _BV(OCF1B);
+  TIMSK1 = _BV(OCIE1B);
+  CRITICAL_END();
+  while (latency_count < LATENCY_SAMPLES) {
+    ros_sem_give(&ping_sem);
+    ros_sem_take(&pong_sem, ROS_NO_WAIT);
+    tick_cycles();
+  }
+  report("latency_min", 0, latency_min);
+  report("latency_max", 0, latency_max);
+}
+
+void bench_task() {
+  cycle_counter_init();
+  report("overhead", 0, overhead);
+  bench_switch();
+  bench_schedule();
+  bench_tick();
+  bench_latency();
+  report("done", 0, 0);
+  // simavr quits when sleeping with interrupt disabled
+  cli();
+  sleep_enable();
+  sleep_cpu();
+}
+
+int main() {
+  if (ros_init()) {
+    ros_sem_init(&ping_sem, 0);
+    ros_sem_init(&pong_sem, 0);
+    ros_create_task(&pong_tcb, pong_task, PONG_PRIORITY, pong_stack,
+                    ROS_DEFAULT_STACK_SIZE);
+    ros_create_task(&bench_tcb, bench_task, BENCH_PRIORITY, bench_stack,
+                    ROS_DEFAULT_STACK_SIZE);
+    ros_schedule();
+  }
+  return 0;
+}
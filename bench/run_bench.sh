@@ -0,0 +1,49 @@
+#!/bin/sh
+# Run the benchmark firmware under simavr, and write the results as CSV.
+# usage: run_bench.sh ros_bench.elf results.csv [baseline.csv]
+# With a baseline, exit 1 if any result is more than BENCH_TOLERANCE percent
+# (default 5) slower than it. A missing baseline is warned about.
+ELF=$1
+RESULTS=$2
+BASELINE=$3
+SIMAVR=${SIMAVR:-simavr}
+TOLERANCE=${BENCH_TOLERANCE:-5}
+
+if [ -z "$ELF" ] || [ -z "$RESULTS" ]; then
+  echo "usage: $0 ros_bench.elf results.csv [baseline.csv]" >&2
+  exit 2
+fi
+
+# the console lines may be prefixed by simavr, keep the "bench,..." part
+RAW=$(timeout 60 "$SIMAVR" -m atmega328p -f 16000000 "$ELF" 2>&1 |
+  tr -d '\r' | sed -n 's/.*\(bench,[a-z_]*,[0-9]*,[0-9]*\).*/\1/p')
+
+if ! echo "$RAW" | grep -q '^bench,done,'; then
+  echo "benchmark did not finish:" >&2
+  echo "$RAW" >&2
+  exit 1
+fi
+
+echo "name,n,cycles" > "$RESULTS"
+echo "$RAW" | grep -v '^bench,done,' | cut -d, -f2- >> "$RESULTS"
+cat "$RESULTS"
+
+# no baseline is committed until one is recorded by simavr on a known good
+# tree, so say so instead of passing silently
+if [ -z "$BASELINE" ] || [ ! -f "$BASELINE" ]; then
+  echo "no baseline${BASELINE:+ at $BASELINE}, nothing compared:" \
+    "keep $RESULTS of a known good run as one" >&2
+  exit 0
+fi
+awk -F, -v tolerance="$TOLERANCE" '
+  FNR == 1 { next }
+  NR == FNR { base[$1 "," $2] = $3; next }
+  ($1 "," $2) in base {
+    limit = base[$1 "," $2] * (100 + tolerance) / 100
+    if ($3 > limit) {
+      printf "regression: %s n=%s %d cycles, baseline %d\n", $1, $2, $3, base[$1 "," $2]
+      failed = 1
+    }
+  }
+  END { exit failed }
+' "$BASELINE" "$RESULTS"
@@ -0,0 +1,53 @@
+/**
+ * Blink example in ROS for the Linux port, the LEDs are printed to stdout
+ */
+#include <stdio.h>
+#include "ros.h"
+
+#define LED1 13
+#define LED2 12
+
+#define TASK1_PRIORITY 1
+#define TASK2_PRIORITY 0  // max priority
+
+// stdio is not reentrant, so never print with the tick signal unblocked
+static void led_set(int led, int on) {
+  CRITICAL_STORE;
+  CRITICAL_START();
+  printf("[%lu] LED%d %s\n", (unsigned long)ros_get_sys_tick(), led,
+         on ? "on" : "off");
+  fflush(stdout);
+  CRITICAL_END();
+}
+
+void t1() {
+  while (1) {
+    led_set(LED1, 1);
+    ros_delay(200);
+    led_set(LED1, 0);
+    ros_delay(200);
+  }
+}
+
+void t2() {
+  while (1) {
+    led_set(LED2, 1);
+    // delay a second
+    ros_delay(100);
+    led_set(LED2, 0);
+    ros_delay(100);
+  }
+}
+
+// created by ros_init()
+ROS_TASK(task1, t1, TASK1_PRIORITY, ROS_DEFAULT_STACK_SIZE);
+ROS_TASK(task2, t2, TASK2_PRIORITY, ROS_DEFAULT_STACK_SIZE);
+ROS_TASK_TABLE(&task1, &task2);
+
+int main() {
+  bool os_started = ros_init();
+  if (os_started) {
+    ros_schedule();
+  }
+  return 0;
+}
@@ -1,5 +1,9 @@
 // A preemptive priority scheduler
 #include "ros.h"
+#include <string.h>
+#if ROS_MUTEXES
+#include "ros_mutex.h"
+#endif
 
 /*private fields and functions*/
 
@@ -8,20 +12,164 @@ static ROS_TCB idle_tcb;
 static uint8_t idle_task_stack[ROS_IDLE_STACK_SIZE];
 // current running task
 static ROS_TCB *current_tcb = NULL;
+// a task above the current one is ready, or the current one's turn of round
+// robin is over: the scheduler has to run at the end of the ISR
+static bool need_schedule = false;
+// nesting depth of ros_sched_lock(), the current task is not preempted while
+// it's not 0, and the scheduler runs at the last ros_sched_unlock()
+static volatile uint8_t sched_lock_depth = 0;
+
+// all the created tasks, linked by next_task
+static ROS_TCB *task_list = NULL;
+#if ROS_CPU_STATS
+// timestamp of the last context switch, and of the last stats reset
+static uint32_t switch_stamp;
+static uint32_t stats_stamp;
+#endif
+#if ROS_TRACE
+static uint8_t next_trace_id = 0;
+#endif
 
 static void ros_switch_context_shell(ROS_TCB *old_tcb, ROS_TCB *new_tcb);
+static ROS_TCB *schedule_next();
+static void task_init(ROS_TCB *tcb);
+static void task_list_add(ROS_TCB *tcb);
+static void wait_cancel(ROS_TCB *tcb, status_t status);
 
 /*Global fields*/
 
 bool ROS_STARTED = false;
 
+// no static task, unless the application defines it with ROS_TASK_TABLE()
+__attribute__((weak)) ROS_TCB *const ros_task_table[] = {NULL};
+
+/**
+ * The ready queue is a FIFO tcb list for every priority, plus a two level
+ * bitmap(like uC/OS) to find the highest ready priority: bit n of ready_group
+ * is set if any priority in [8n, 8n+7] is ready, and bit m of ready_table[n]
+ * is set if priority 8n+m is ready. So enqueue, dequeue and finding the
+ * highest ready priority all take O(1) time complexity.
+ */
+#if ROS_PRIORITY_LEVELS < 1 || ROS_PRIORITY_LEVELS > 64
+#error "ROS_PRIORITY_LEVELS should be 1~64"
+#endif
+
+typedef struct {
+  ROS_TCB *head;
+  ROS_TCB *tail;
+} ROS_TCB_LIST;
+
+static uint8_t ready_group = 0;
+static uint8_t ready_table[(ROS_PRIORITY_LEVELS + 7) / 8];
+static ROS_TCB_LIST ready_list[ROS_PRIORITY_LEVELS];
+
+// index of the lowest set bit in a nibble, 0 is never looked up
+static const uint8_t lowest_bit_table[16] = {0, 0, 1, 0, 2, 0, 1, 0,
+                                             3, 0, 1, 0, 2, 0, 1, 0};
+
+// index of the lowest set bit of a non-zero byte
+static inline uint8_t lowest_bit(uint8_t bits) {
+  if (bits & 0x0F) return lowest_bit_table[bits & 0x0F];
+  return 4 + lowest_bit_table[bits >> 4];
+}
+
+// the list of priority is empty now
+static inline void clear_ready_bit(uint8_t priority) {
+  ready_table[priority >> 3] &= ~(1 << (priority & 0x07));
+  if (ready_table[priority >> 3] == 0) ready_group &= ~(1 << (priority >> 3));
+}
+
+// highest ready priority, the ready queue should not be empty
+static inline uint8_t highest_ready_priority() {
+  uint8_t group = lowest_bit(ready_group);
+  return (group << 3) + lowest_bit(ready_table[group]);
+}
+
+#if ROS_SCHED_EDF
+// a is due before b, a task with no deadline is due after all the others
+static inline bool due_before(ROS_TCB *a, ROS_TCB *b) {
+  if (a->relative_deadline == 0) return false;
+  if (b->relative_deadline == 0) return true;
+  // the sys tick may wrap around, compare the difference
+  return ros_time_before(a->deadline, b->deadline);
+}
+
+// a new job of the task starts now
+static inline void release_job(ROS_TCB *tcb) {
+  tcb->deadline = ros_get_sys_tick() + tcb->relative_deadline;
+}
+
+#endif
+
+// a ready task of the same priority should take over the current task
+static bool peer_preempts(uint8_t priority) {
+#if ROS_SCHED_EDF
+  ROS_TCB *head = ready_list[priority].head;
+  if (head == NULL) return false;
+  // the tasks with no deadline still do round-robin
+  if (head->relative_deadline || current_tcb->relative_deadline) {
+    return due_before(head, current_tcb);
+  }
+#else
+  (void)priority;
+#endif
+  return current_tcb->slice_left == 0;
+}
+
+#if ROS_STACK_CHECK
+// the stack grows down, the guard is the lowest bytes of the painted stack
+static bool stack_guard_intact(ROS_TCB *tcb) {
+  uint8_t i;
+  for (i = 0; i < ROS_STACK_GUARD_SIZE; i++) {
+    if (tcb->stack[i] != ROS_STACK_FILL) return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Called when the stack guard of the task swapped out is overwritten.
+ * The default one stops the system with interrupt disabled, define your own
+ * one to report it.
+ */
+__attribute__((weak)) void ros_stack_overflow(ROS_TCB *tcb) {
+  CRITICAL_STORE;
+  (void)tcb;
+  CRITICAL_START();
+  while (1) {
+  }
+  CRITICAL_END();
+}
+#endif
+
+// a new turn, without round robin it only ends by ros_yield()
+static void slice_start(ROS_TCB *tcb) {
+  tcb->slice_left = tcb->time_slice ? tcb->time_slice : 1;
+}
+
 /**
- * The tcb list is a single linked list, and it's ordered by priority.
- * The head of list always has the highest priority, there's already a idel task
- * whil os started, so when schedule just take the head of list, but the enqueue
- * operations take O(N) time complexity, the dequeue is O(1).
+ * @brief Bookkeeping of a context switch before the registers and stack are
+ * switched: catch up the ticks, check the stack, account the CPU time and set
+ * the current_tcb. Interrupt should be disabled.
  */
-ROS_TCB *tcb_ready_list = NULL;
+static void switch_prepare(ROS_TCB *old_tcb, ROS_TCB *new_tcb) {
+#if ROS_TICKLESS
+  // the idle task may sleep across many ticks, catch up before leaving it
+  if (old_tcb == &idle_tcb) ros_tickless_exit();
+#endif
+#if ROS_STACK_CHECK
+  if (old_tcb && !stack_guard_intact(old_tcb)) ros_stack_overflow(old_tcb);
+#endif
+#if ROS_CPU_STATS
+  // the ISRs are accounted to the task they interrupted
+  uint32_t now = ros_port_timestamp();
+  if (old_tcb) old_tcb->run_time += now - switch_stamp;
+  switch_stamp = now;
+  new_tcb->switch_count++;
+#endif
+  ROS_TRACE_EVENT(ROS_TRACE_SWITCH, new_tcb->trace_id);
+  slice_start(new_tcb);
+  current_tcb = new_tcb;  // we don't need to update current_tcb in asm code
+}
 
 /**
  * @brief  Warpper function of context switch. It will be called by schduler,set
@@ -34,7 +182,7 @@ ROS_TCB *tcb_ready_list = NULL;
 static void ros_switch_context_shell(ROS_TCB *old_tcb, ROS_TCB *new_tcb) {
   // diable self-preemption
   if (old_tcb != new_tcb) {
-    current_tcb = new_tcb;  // we don't need to update current_tcb in asm code
+    switch_prepare(old_tcb, new_tcb);
     // the old_tcb is previous current_tcb
     ros_switch_context(old_tcb, new_tcb);
   }
@@ -44,19 +192,132 @@ static void ros_switch_context_shell(ROS_TCB *old_tcb, ROS_TCB *new_tcb) {
  * @brief  Start the os:
  * 1. init the system timer, start ticking
  * 2. add a idle task into the list
+ * 3. add the work queue task if ROS_WORK_QUEUE
+ * 4. add the tasks of ros_task_table
  * @retval ture if os started
  */
 bool ros_init() {
   CRITICAL_STORE;
   CRITICAL_START();
   ros_init_timer();
+#if ROS_CPU_STATS
+  stats_stamp = switch_stamp = ros_port_timestamp();
+#endif
   status_t ok =
       ros_create_task(&idle_tcb, ros_idle_task, MIN_TASK_PRIORITY, idle_task_stack, ROS_IDLE_STACK_SIZE);
+#if ROS_WORK_QUEUE
+  if (ok == ROS_OK) ok = ros_work_start();
+#endif
+  // the static tasks are checked at compile time, set up all of them and fill
+  // the ready queue in one pass
+  ROS_TCB *const *table;
+  for (table = ros_task_table; *table; table++) {
+    task_init(*table);
+    task_list_add(*table);
+    ros_tcb_enqueue(*table);
+  }
   ROS_STARTED = ok == ROS_OK;
   CRITICAL_END();
   return ROS_STARTED;
 }
 
+/**
+ * @brief Bytes of the task's stack ever used, found from the painted bytes
+ * never touched. Use it to right-size the stack.
+ */
+uint16_t ros_task_stack_high_water(ROS_TCB *tcb) {
+  uint16_t unused = 0;
+  if (tcb == NULL || tcb->stack == NULL) return 0;
+  while (unused < tcb->stack_size && tcb->stack[unused] == ROS_STACK_FILL) {
+    unused++;
+  }
+  return tcb->stack_size - unused;
+}
+
+/**
+ * @retval deadlines the task missed in ros_delay_until()
+ */
+uint16_t ros_task_deadline_misses(ROS_TCB *tcb) {
+  return tcb ? tcb->deadline_misses : 0;
+}
+
+#if ROS_SCHED_EDF
+/**
+ * @brief Set the relative deadline of a task, a new job is released now. Every
+ * time the task is woken up(e.g. by ros_delay_until()), a new job is released
+ * with the deadline relative_deadline ticks later.
+ * @param  relative_deadline: ticks, usually the period. 0 for no deadline, the
+ * task runs after all the ones with a deadline of the same priority
+ * @retval ROS_OK Success
+ * @retval ROS_ERR_PARAM Bad param
+ */
+status_t ros_task_set_deadline(ROS_TCB *tcb, uint32_t relative_deadline) {
+  CRITICAL_STORE;
+  if (tcb == NULL) return ROS_ERR_PARAM;
+  CRITICAL_START();
+  tcb->relative_deadline = relative_deadline;
+  release_job(tcb);
+  // keep the ready queue ordered
+  if (tcb->status == TASK_READY && tcb != current_tcb) {
+    ros_tcb_remove(tcb);
+    ros_tcb_enqueue(tcb);
+  }
+  CRITICAL_END();
+  if (ROS_STARTED && ros_current_tcb()) ros_schedule();
+  return ROS_OK;
+}
+#endif
+
+/**
+ * @brief Iterate all the created tasks, including the idle task. Lock the
+ * scheduler around the walk, so no task is created or deleted meanwhile.
+ * @param  *tcb: NULL to get the first task
+ * @retval the task after tcb, NULL if it's the last one
+ */
+ROS_TCB *ros_task_next(ROS_TCB *tcb) {
+  return tcb ? tcb->next_task : task_list;
+}
+
+#if ROS_CPU_STATS
+/**
+ * @brief Start a new window of CPU usage, clear run time and switch count of
+ * every task
+ */
+void ros_cpu_stats_reset() {
+  ROS_TCB *tcb;
+  // the stats only change at a context switch
+  ros_sched_lock();
+  for (tcb = task_list; tcb; tcb = tcb->next_task) {
+    tcb->run_time = 0;
+    tcb->switch_count = 0;
+  }
+  stats_stamp = switch_stamp = ros_port_timestamp();
+  ros_sched_unlock();
+}
+
+/**
+ * @retval ros_port_timestamp() counts the task has run since last reset, up to
+ * now if it's running
+ */
+uint32_t ros_task_run_time(ROS_TCB *tcb) {
+  ros_sched_lock();
+  uint32_t run_time = tcb->run_time;
+  if (tcb == current_tcb) run_time += ros_port_timestamp() - switch_stamp;
+  ros_sched_unlock();
+  return run_time;
+}
+
+/**
+ * @retval CPU usage of the task since last reset, in percent
+ */
+uint8_t ros_task_cpu_usage(ROS_TCB *tcb) {
+  uint32_t total = ros_port_timestamp() - stats_stamp;
+  if (total < 100) return 0;
+  uint32_t usage = ros_task_run_time(tcb) / (total / 100);
+  return usage > 100 ? 100 : usage;
+}
+#endif
+
 /**
  * @retval current tcb if NOT in interrupt service routine
  */
@@ -65,39 +326,229 @@ ROS_TCB *ros_current_tcb() {
   return NULL;
 }
 
+/**
+ * @brief Set up a task from the entry, priority and stack already in the tcb:
+ * paint the stack, reset the kernel fields and init the context. It's not in
+ * the ready queue yet.
+ */
+static void task_init(ROS_TCB *tcb) {
+  // paint the stack, the bytes never touched tell the high-water mark
+  memset(tcb->stack, ROS_STACK_FILL, tcb->stack_size);
+  tcb->base_priority = tcb->priority;
+  tcb->next_tcb = NULL;
+  tcb->prev_tcb = NULL;
+  tcb->status = TASK_READY;
+  tcb->wait_list = NULL;
+  tcb->timer = NULL;
+  tcb->deadline_misses = 0;
+#if ROS_SCHED_EDF
+  release_job(tcb);
+#endif
+#if ROS_TASK_NOTIFY
+  tcb->notify_value = 0;
+  tcb->notify_state = 0;
+#endif
+#if ROS_MUTEXES
+  tcb->held_mutex = NULL;
+  tcb->wait_mutex = NULL;
+#endif
+#if ROS_CPU_STATS
+  tcb->run_time = 0;
+  tcb->switch_count = 0;
+#endif
+
+  // Initial task context(pc, calle-used registers), and set current stack
+  // pointer to tcb
+  ros_task_context_init(tcb, tcb->task_entry,
+                        STACK_POINT(tcb->stack, tcb->stack_size));
+}
+
+// add a new task to the task list, the scheduler should be locked
+static void task_list_add(ROS_TCB *tcb) {
+  // a terminated task may be created again, it's already in the task list
+  ROS_TCB *task = task_list;
+  while (task && task != tcb) task = task->next_task;
+  if (task == NULL) {
+    tcb->next_task = task_list;
+    task_list = tcb;
+#if ROS_TRACE
+    tcb->trace_id = next_trace_id++;
+#endif
+  }
+}
+
+// remove a deleted task from the task list, the scheduler should be locked
+static void task_list_remove(ROS_TCB *tcb) {
+  ROS_TCB **link = &task_list;
+  while (*link && *link != tcb) link = &(*link)->next_task;
+  if (*link) *link = tcb->next_task;
+  tcb->next_task = NULL;
+}
+
 /**
  * @brief create a task, valid it then add it to the ready list
  * @param  *tcb: the caller provides the tcb storage
  * @param  task_f: task function entry point
- * @param  priority: task priotity, 0(max) to 255(min)
- * @param  *stack_top: caller provides the stack storage
+ * @param  priority: task priotity, 0(max) to MIN_TASK_PRIORITY(min)
+ * @param  *stack: caller provides the stack storage
+ * @param  stack_size: bytes of stack
  * @retval ROS_OK Success
  * @retval ROS_ERR_PARAM Bad param
  */
 status_t ros_create_task(ROS_TCB *tcb, task_func task_f, uint8_t priority,
                          stack_t *stack, int stack_size) {
   CRITICAL_STORE;
-  if (tcb == NULL || task_f == NULL || stack == NULL || stack_size < ROS_MIN_STACK_SIZE) {
+  if (tcb == NULL || task_f == NULL || stack == NULL ||
+      stack_size < ROS_MIN_STACK_SIZE || priority > MIN_TASK_PRIORITY) {
     return ROS_ERR_PARAM;
   }
-  void *stack_top = STACK_POINT(stack, stack_size);
+  // the task list is only guarded against other tasks
+  if (ros_int_cnt != 0) return ROS_ERR_CONTEXT;
+  tcb->stack = stack;
+  tcb->stack_size = stack_size;
   tcb->priority = priority;
-  tcb->next_tcb = NULL;
-  tcb->status = TASK_READY;
   tcb->task_entry = task_f;
+  tcb->time_slice = ROS_TIME_SLICE;
+#if ROS_SCHED_EDF
+  tcb->relative_deadline = 0;
+#endif
+  task_init(tcb);
 
-  // Initial task context(pc, calle-used registers), and set current stack
-  // pointer to tcb
-  ros_task_context_init(tcb, task_f, stack_top);
-
-  // critical block: disable interrupt
+  // walk the task list with interrupt enabled, only the ready queue is shared
+  // with ISRs
+  ros_sched_lock();
+  task_list_add(tcb);
   CRITICAL_START();
   ros_tcb_enqueue(tcb);
   CRITICAL_END();
-  if (ROS_STARTED && ros_current_tcb()) ros_schedule();
+  ros_sched_unlock();
   return ROS_OK;
 }
 
+/**
+ * @brief Take a task out of the ready queue, or the wait list and the timer
+ * queue, whichever it's in. Interrupt should be disabled.
+ */
+static void task_detach(ROS_TCB *tcb) {
+  if (tcb->status == TASK_READY) {
+    // the running task is not in the ready queue
+    if (tcb != current_tcb) ros_tcb_remove(tcb);
+    // nor sleeping yet on the timer it's registering, see ros_wait_timer()
+    if (tcb->timer) {
+      ros_unregister_timer(tcb->timer);
+      tcb->timer = NULL;
+    }
+  } else if (tcb->status == TASK_BLOCKED) {
+    wait_cancel(tcb, ROS_ERR_TIMEOUT);
+#if ROS_MUTEXES
+    ros_mutex_wait_cancel(tcb);
+#endif
+  }
+}
+
+// the task is not ready any more, swap it out if it's running, even with the
+// scheduler locked if it's terminated
+static void task_stopped(ROS_TCB *tcb) {
+  if (tcb == current_tcb) {
+    // in ISR, it's swapped out at ros_int_exit()
+    need_schedule = true;
+    ros_schedule();
+  }
+}
+
+/**
+ * @brief Suspend a task until ros_task_resume(). A blocked task gives up
+ * waiting, the blocking call returns ROS_ERR_TIMEOUT after it's resumed. The
+ * running task suspended by an ISR while it holds the scheduler lock is
+ * swapped out at its last ros_sched_unlock().
+ * @param  *tcb: the task, NULL for current task
+ * @retval ROS_OK Success
+ * @retval ROS_ERR_PARAM the idle task, or a terminated task
+ * @retval ROS_ERR_CONTEXT NULL in ISR, or current task with the scheduler
+ * locked
+ */
+status_t ros_task_suspend(ROS_TCB *tcb) {
+  status_t status = ROS_OK;
+  CRITICAL_STORE;
+  if (tcb == NULL) tcb = ros_current_tcb();
+  if (tcb == NULL) return ROS_ERR_CONTEXT;
+  if (tcb == &idle_tcb) return ROS_ERR_PARAM;
+  // it can't be swapped out while holding the scheduler lock
+  if (tcb == ros_current_tcb() && sched_lock_depth) return ROS_ERR_CONTEXT;
+  CRITICAL_START();
+  if (tcb->status == TASK_TERMINATED) {
+    status = ROS_ERR_PARAM;
+  } else if (tcb->status != TASK_SUSPENDED) {
+    task_detach(tcb);
+    tcb->status = TASK_SUSPENDED;
+    task_stopped(tcb);
+  }
+  CRITICAL_END();
+  return status;
+}
+
+/**
+ * @brief Make a suspended task ready again, it's safe in ISR
+ * @retval ROS_OK Success
+ * @retval ROS_ERR_PARAM the task is not suspended
+ */
+status_t ros_task_resume(ROS_TCB *tcb) {
+  status_t status = ROS_OK;
+  CRITICAL_STORE;
+  if (tcb == NULL) return ROS_ERR_PARAM;
+  CRITICAL_START();
+  if (tcb->status != TASK_SUSPENDED) {
+    status = ROS_ERR_PARAM;
+  } else {
+    tcb->status = TASK_READY;
+#if ROS_SCHED_EDF
+    release_job(tcb);
+#endif
+    // suspended and resumed in the same ISR, it's still running
+    if (tcb != current_tcb) ros_tcb_enqueue(tcb);
+    // no schedule in ISR, until ros_int_exit()
+    ros_schedule();
+  }
+  CRITICAL_END();
+  return status;
+}
+
+/**
+ * @brief Delete a task: take it out of the ready queue, the wait list and the
+ * timer queue in O(1) time. The tcb and stack can be reused at once, e.g. by
+ * ros_create_task(). A task deleting itself never returns, the scheduler lock
+ * it holds is released.
+ * @param  *tcb: the task, NULL for current task
+ * @retval ROS_OK Success
+ * @retval ROS_ERR_PARAM the idle task
+ * @retval ROS_ERR_CONTEXT in ISR
+ * @retval ROS_ERROR the task holds a mutex, unlock it first
+ */
+status_t ros_task_delete(ROS_TCB *tcb) {
+  status_t status = ROS_OK;
+  CRITICAL_STORE;
+  if (ros_int_cnt != 0) return ROS_ERR_CONTEXT;
+  if (tcb == NULL) tcb = current_tcb;
+  if (tcb == NULL) return ROS_ERR_CONTEXT;
+  if (tcb == &idle_tcb) return ROS_ERR_PARAM;
+  // the task list and the mutexes are shared by tasks only
+  ros_sched_lock();
+#if ROS_MUTEXES
+  if (tcb->held_mutex) status = ROS_ERROR;
+#endif
+  if (status == ROS_OK) {
+    task_list_remove(tcb);
+    // but an ISR may wake it up or suspend it
+    CRITICAL_START();
+    task_detach(tcb);
+    tcb->status = TASK_TERMINATED;
+    CRITICAL_END();
+  }
+  ros_sched_unlock();
+  if (status == ROS_OK) task_stopped(tcb);
+  return status;
+}
+
 /**
  * OS core scheduler implementation.
  * The scheduler will be called only in follwing 3 places:
@@ -108,100 +559,424 @@ status_t ros_create_task(ROS_TCB *tcb, task_func task_f, uint8_t priority,
  *
  * The schduler is preemptive priority-based with round-robin.The round-robin is
  * only preformed for the task with same priority.We allow swap in the task,
- * when its priority is NO LESS than current task.
+ * when its priority is higher than current task, or the same once the current
+ * task's time slice is used up.
  *
- * While scheduler is based on the list operations: enqueue and dequeue, so the
- * scheduler tasks O(N) timer complexity.
+ * While scheduler is based on the ready queue operations: enqueue and dequeue,
+ * so the scheduler takes O(1) time complexity.
  */
 void ros_schedule() {
   // no schedule and context switch util the very end of ISR
   if (ros_int_cnt != 0 || !ROS_STARTED) return;
   CRITICAL_STORE;
-  ROS_TCB *new_tcb = NULL;
   CRITICAL_START();
+  if (sched_lock_depth) {
+    // a task suspended by an ISR is swapped out at the last unlock as well
+    if (current_tcb->status != TASK_TERMINATED) {
+      // deferred to ros_sched_unlock()
+      need_schedule = true;
+      CRITICAL_END();
+      return;
+    }
+    // the task holding the lock is gone, by returning or deleting itself
+    sched_lock_depth = 0;
+  }
+  ROS_TCB *new_tcb = schedule_next();
+  if (new_tcb) ros_switch_context_shell(current_tcb, new_tcb);
+  CRITICAL_END();
+}
+
+/**
+ * @brief Lock the scheduler: the current task is not preempted by another task
+ * until ros_sched_unlock(), but interrupts stay enabled. Use it instead of a
+ * critical section for the data shared by tasks only. It nests, and it does
+ * nothing in ISR, where no task switch happens anyway. Don't block with the
+ * scheduler locked, the blocking calls return ROS_ERR_CONTEXT.
+ */
+void ros_sched_lock() {
+  // an ISR never changes the depth, no need to disable interrupt
+  if (ros_current_tcb() && sched_lock_depth < UINT8_MAX) sched_lock_depth++;
+}
+
+/**
+ * @brief Unlock the scheduler, the last unlock runs the scheduler if a task
+ * switch was deferred while it was locked
+ */
+void ros_sched_unlock() {
+  if (ros_current_tcb() == NULL || sched_lock_depth == 0) return;
+  sched_lock_depth--;
+  ROS_BARRIER();
+  // an ISR from now on runs the scheduler by itself
+  if (sched_lock_depth == 0 && need_schedule) ros_schedule();
+}
+
+/**
+ * @retval the scheduler is locked by the current task
+ */
+bool ros_sched_locked() { return sched_lock_depth != 0; }
+
+/**
+ * @brief Give up the rest of the time slice to the ready tasks of the same
+ * priority. If there is none, it returns at once with a new time slice
+ */
+void ros_yield() {
+  CRITICAL_STORE;
+  if (ros_current_tcb() == NULL) return;
+  CRITICAL_START();
+  current_tcb->slice_left = 0;
+  ros_schedule();
+  // nobody took over: a new turn, or the next tick finds the slice used up.
+  // With the scheduler locked, the yield is left to ros_sched_unlock()
+  if (current_tcb->slice_left == 0 && !sched_lock_depth) {
+    slice_start(current_tcb);
+  }
+  CRITICAL_END();
+}
+
+/**
+ * @brief Set the ticks a task runs before the ready tasks of the same priority
+ * get their turn. It takes effect from the next turn.
+ * @param  ticks: 1~255, or 0 to turn round robin off for the task: it runs
+ * until it blocks or calls ros_yield()
+ * @retval ROS_ERR_PARAM tcb is NULL
+ */
+status_t ros_task_set_time_slice(ROS_TCB *tcb, uint8_t ticks) {
+  if (tcb == NULL) return ROS_ERR_PARAM;
+  tcb->time_slice = ticks;
+  return ROS_OK;
+}
+
+/**
+ * @brief Charge the running task's time slice, called by the tick ISR. When it
+ * is used up and a peer is ready, the scheduler runs at ros_int_exit().
+ * @param  ticks: ticks elapsed
+ */
+void ros_time_slice_tick(uint32_t ticks) {
+  ROS_TCB *tcb = current_tcb;
+  if (tcb == NULL || tcb->time_slice == 0) return;
+  if (tcb->slice_left > ticks) {
+    tcb->slice_left -= ticks;
+    return;
+  }
+  tcb->slice_left = 0;
+  if (ready_list[tcb->priority].head) need_schedule = true;
+}
+
+/**
+ * @brief Pick the task to swap in, the current task is put back to the ready
+ * queue if it's still ready. Interrupt should be disabled.
+ * @retval the task to swap in, NULL to keep running the current one
+ */
+static ROS_TCB *schedule_next() {
+  ROS_TCB *new_tcb = NULL;
+  need_schedule = false;
   // if current task is NULL or suspend or terminated, a new task will swap in
   // unconditionally
-  if (current_tcb == NULL || current_tcb->status == TASK_BLOCKED ||
-      current_tcb->status == TASK_TERMINATED) {
-    // task with any priority(0~255) can be swap in
+  if (current_tcb == NULL || current_tcb->status != TASK_READY) {
+    // task with any priority(0~MIN_TASK_PRIORITY) can be swap in
+    // Do not enqueue curren_tcb here, when the task is blocked, it is added
+    // to timer_queue, it will enqueue when the ticks due.
     new_tcb = ros_tcb_dequeue(MIN_TASK_PRIORITY);
-    if (new_tcb) {
-      // Do not enqueue curren_tcb here, when the task is blocked, it is added
-      // to timer_queue, it will enqueue when the ticks due.
-      ros_switch_context_shell(current_tcb, new_tcb);
-    } else {
-      // but you can't block the idle task
-      if (current_tcb == &idle_tcb) current_tcb->status = TASK_READY;
+    // but you can't block the idle task
+    if (new_tcb == NULL && current_tcb == &idle_tcb) {
+      current_tcb->status = TASK_READY;
     }
   } else {
-    // remove terminated task
-    do {
-      new_tcb = ros_tcb_dequeue(current_tcb->priority);
-    } while (new_tcb && new_tcb->status == TASK_TERMINATED);
-    if (new_tcb) {
-      ros_tcb_enqueue(current_tcb);
-      ros_switch_context_shell(current_tcb, new_tcb);
+    uint8_t lowest_priority = current_tcb->priority;
+    // only a higher priority, or the same priority when the turn is over(or
+    // the deadline is earlier with ROS_SCHED_EDF)
+    if (!peer_preempts(lowest_priority)) {
+      if (lowest_priority == MAX_TASK_PRIORITY) return NULL;
+      lowest_priority--;
     }
+    new_tcb = ros_tcb_dequeue(lowest_priority);
+    if (new_tcb) ros_tcb_enqueue(current_tcb);
   }
-  CRITICAL_END();
+  return new_tcb;
 }
 
 /**
- * @brief enqueue tcb to list order by priority. Do round-robin when priority is
- * same.
+ * @brief enqueue tcb to the tail of its priority list, so the tasks with same
+ * priority do round-robin. With ROS_SCHED_EDF, the list is ordered by deadline.
  * @param  *tcb: the tcb to insert
  */
 void ros_tcb_enqueue(ROS_TCB *tcb) {
   if (tcb == NULL) return;
-  ROS_TCB *prev_ptr, *next_ptr;
-  prev_ptr = next_ptr = tcb_ready_list;
-  do {
-    // Insert when:
-    // next == NULL
-    // next tcb's priority is lower than than the one we enqueuing
-    // same priority task will do round-bobin
-    if ((next_ptr == NULL) || (next_ptr->priority > tcb->priority)) {
-      // list is empty or insert to head
-      if (next_ptr == tcb_ready_list) {
-        tcb_ready_list = tcb;
-        tcb->next_tcb = next_ptr;  // next_ptr maybe NULL
-      } else {                     // insert between tow tcb or tail
-        tcb->next_tcb = next_ptr;  // next_ptr maybe NUL
-        prev_ptr->next_tcb = tcb;
-      }
-      break;
+  uint8_t priority = tcb->priority;
+  ROS_TCB_LIST *list = &ready_list[priority];
+  // it preempts the current task at the end of the ISR
+  if (current_tcb && (priority < current_tcb->priority
+#if ROS_SCHED_EDF
+                      || (priority == current_tcb->priority &&
+                          due_before(tcb, current_tcb))
+#endif
+                      )) {
+    need_schedule = true;
+  }
+#if ROS_SCHED_EDF
+  // ordered by deadline, after the ones due at the same time
+  if (list->head && due_before(tcb, list->tail)) {
+    ROS_TCB *next = list->head;
+    while (!due_before(tcb, next)) next = next->next_tcb;
+    tcb->next_tcb = next;
+    tcb->prev_tcb = next->prev_tcb;
+    if (next->prev_tcb) {
+      next->prev_tcb->next_tcb = tcb;
     } else {
-      prev_ptr = next_ptr;
-      next_ptr = next_ptr->next_tcb;
+      list->head = tcb;
     }
-  } while (prev_ptr != NULL);
+    next->prev_tcb = tcb;
+    return;
+  }
+#endif
+  tcb->next_tcb = NULL;
+  tcb->prev_tcb = list->tail;
+  if (list->tail) {
+    list->tail->next_tcb = tcb;
+  } else {
+    list->head = tcb;
+    ready_group |= 1 << (priority >> 3);
+    ready_table[priority >> 3] |= 1 << (priority & 0x07);
+  }
+  list->tail = tcb;
 }
 
 /**
  * @brief  dequeue a tcb to swap in, requeir its priority no lower than
- * lowest_priority Because the list ordered by priority, we just check the head,
- * if the head is lower than lowest_priority, return NULL. use
- * ros_tcb_dequeue(MIN_TASK_PRIORITY) to dequeue head unconditionally
+ * lowest_priority. Just check the highest ready priority, if it is lower than
+ * lowest_priority, return NULL. use ros_tcb_dequeue(MIN_TASK_PRIORITY) to
+ * dequeue the highest tcb unconditionally
  * @param lowest_priority: the lowest priority of dequeue tcb or NULL if no such
  * tcb
  */
 ROS_TCB *ros_tcb_dequeue(uint8_t lowest_priority) {
-  if (tcb_ready_list == NULL || tcb_ready_list->priority > lowest_priority) {
-    return NULL;
+  if (ready_group == 0) return NULL;
+  uint8_t priority = highest_ready_priority();
+  if (priority > lowest_priority) return NULL;
+  ROS_TCB_LIST *list = &ready_list[priority];
+  ROS_TCB *tcb = list->head;
+  list->head = tcb->next_tcb;
+  if (list->head) {
+    list->head->prev_tcb = NULL;
   } else {
-    ROS_TCB *tcb = tcb_ready_list;
-    tcb_ready_list = tcb_ready_list->next_tcb;
-    if (tcb_ready_list) {
-      // make return tcb isolated
-      tcb->next_tcb = NULL;
-    }
-    return tcb;
+    list->tail = NULL;
+    clear_ready_bit(priority);
+  }
+  // make return tcb isolated
+  tcb->next_tcb = NULL;
+  return tcb;
+}
+
+/**
+ * @brief remove a tcb from the ready queue in O(1) time, it should be in the
+ * queue: ready and not the current task
+ * @param  *tcb: the tcb to remove
+ */
+void ros_tcb_remove(ROS_TCB *tcb) {
+  uint8_t priority = tcb->priority;
+  ROS_TCB_LIST *list = &ready_list[priority];
+  if (tcb->prev_tcb) {
+    tcb->prev_tcb->next_tcb = tcb->next_tcb;
+  } else {
+    list->head = tcb->next_tcb;
   }
+  if (tcb->next_tcb) {
+    tcb->next_tcb->prev_tcb = tcb->prev_tcb;
+  } else {
+    list->tail = tcb->prev_tcb;
+  }
+  if (list->head == NULL) clear_ready_bit(priority);
+  tcb->next_tcb = NULL;
+  tcb->prev_tcb = NULL;
 }
 
-void ros_int_enter() { ros_int_cnt++; }
+/**
+ * @brief insert tcb to wait list order by priority, after the tasks with same
+ * priority
+ */
+static void wait_list_insert(ROS_TCB **wait_list, ROS_TCB *tcb) {
+  ROS_TCB *prev = NULL, *next = *wait_list;
+  while (next && next->priority <= tcb->priority) {
+    prev = next;
+    next = next->next_tcb;
+  }
+  tcb->prev_tcb = prev;
+  tcb->next_tcb = next;
+  if (next) next->prev_tcb = tcb;
+  if (prev) {
+    prev->next_tcb = tcb;
+  } else {
+    *wait_list = tcb;
+  }
+}
 
-void ros_int_exit() { 
-  ros_int_cnt--;
+// remove tcb from the wait list in O(1) time
+static void wait_list_remove(ROS_TCB **wait_list, ROS_TCB *tcb) {
+  if (tcb->prev_tcb) {
+    tcb->prev_tcb->next_tcb = tcb->next_tcb;
+  } else {
+    *wait_list = tcb->next_tcb;
+  }
+  if (tcb->next_tcb) tcb->next_tcb->prev_tcb = tcb->prev_tcb;
+  tcb->next_tcb = NULL;
+  tcb->prev_tcb = NULL;
+}
+
+// stop waiting: leave the wait list and cancel the timeout
+static void wait_cancel(ROS_TCB *tcb, status_t status) {
+  if (tcb->wait_list) {
+    wait_list_remove(tcb->wait_list, tcb);
+    tcb->wait_list = NULL;
+  }
+  if (tcb->timer) {
+    ros_unregister_timer(tcb->timer);
+    tcb->timer = NULL;
+  }
+  tcb->wait_status = status;
+}
+
+#if ROS_SCHED_EDF
+// the job is done when the task blocks, count it if it's late
+static void job_done(ROS_TCB *tcb) {
+  if (tcb->relative_deadline &&
+      ros_time_after(ros_get_sys_tick(), tcb->deadline) &&
+      tcb->deadline_misses < UINT16_MAX) {
+    tcb->deadline_misses++;
+  }
+}
+#endif
+
+// block current task on the wait list and tcb->timer, until woken up
+static status_t wait_block(ROS_TCB *tcb, ROS_TCB **wait_list) {
+#if ROS_SCHED_EDF
+  job_done(tcb);
+#endif
+  tcb->status = TASK_BLOCKED;
+  tcb->wait_status = ROS_ERR_TIMEOUT;
+  tcb->wait_list = wait_list;
+  if (wait_list) wait_list_insert(wait_list, tcb);
+  // swap out current task, we come back here when woken up
   ros_schedule();
-}
\ No newline at end of file
+  return tcb->wait_status;
+}
+
+/**
+ * @brief Block current task on a wait list of kernel object, until it is woken
+ * up by ros_wake() or the timeout expires. Interrupt should be disabled, so
+ * the object can't be changed between checking it and blocking. The timer
+ * queue is walked with interrupt disabled too, ros_wait_timer() doesn't.
+ * @param  **wait_list: wait list of the object, NULL to just sleep
+ * @param  timeout: ticks to wait, or ROS_WAIT_FOREVER
+ * @retval ROS_OK woken up by the object
+ * @retval ROS_ERR_TIMEOUT timeout expired
+ * @retval ROS_ERR_CONTEXT not in a task, or the scheduler is locked
+ */
+status_t ros_wait(ROS_TCB **wait_list, uint32_t timeout) {
+  ROS_TIMER timer;
+  ROS_TCB *tcb = ros_current_tcb();
+  if (tcb == NULL || sched_lock_depth) return ROS_ERR_CONTEXT;
+  tcb->timer = NULL;
+  if (timeout != ROS_WAIT_FOREVER) {
+    // the timer lives on the stack of the blocked task
+    timer.ticks = timeout;
+    timer.blocked_tcb = tcb;
+    ros_register_timer(&timer);
+    tcb->timer = &timer;
+  }
+  return wait_block(tcb, wait_list);
+}
+
+/**
+ * @brief Sleep on a timer of current task until it expires. The timer is set
+ * to tcb->timer and registered before, with interrupt enabled, so the walk of
+ * the timer queue can be preempted(ros_delay()). Meanwhile it may expire, or
+ * ros_task_suspend() may cancel it, then the task doesn't sleep at all.
+ * Interrupt should be disabled.
+ * @retval ROS_ERR_TIMEOUT the timer expired
+ * @retval ROS_ERR_CONTEXT not in a task, or the scheduler is locked
+ */
+status_t ros_wait_timer(ROS_TIMER *timer) {
+  ROS_TCB *tcb = ros_current_tcb();
+  status_t status = ROS_ERR_TIMEOUT;
+  if (tcb == NULL || sched_lock_depth) {
+    status = ROS_ERR_CONTEXT;
+  } else if (tcb->timer == timer) {
+    return wait_block(tcb, NULL);
+  } else {
+#if ROS_SCHED_EDF
+    // as if it blocked and was woken up at once
+    job_done(tcb);
+    release_job(tcb);
+#endif
+  }
+  // it's not slept on, one cancelled while registering may be in the queue
+  ros_unregister_timer(timer);
+  if (tcb) tcb->timer = NULL;
+  return status;
+}
+
+/**
+ * @brief Wake up a blocked task: remove it from the wait list, cancel its
+ * timeout and add it to the ready queue. It's safe in ISR, the task will be
+ * scheduled at ros_int_exit().
+ * @param  *tcb: the blocked task
+ * @param  status: returned by ros_wait()
+ */
+void ros_wake(ROS_TCB *tcb, status_t status) {
+  if (tcb == NULL || tcb->status != TASK_BLOCKED) return;
+  wait_cancel(tcb, status);
+  tcb->status = TASK_READY;
+#if ROS_SCHED_EDF
+  release_job(tcb);
+#endif
+  ros_tcb_enqueue(tcb);
+  ROS_TRACE_EVENT(ROS_TRACE_WAKEUP, tcb->trace_id);
+}
+
+/**
+ * @brief Change the priority of a task, and keep the ready queue or the wait
+ * list it's in ordered. Interrupt should be disabled.
+ */
+void ros_tcb_set_priority(ROS_TCB *tcb, uint8_t priority) {
+  if (tcb->status == TASK_READY && tcb != current_tcb) {
+    ros_tcb_remove(tcb);
+    tcb->priority = priority;
+    ros_tcb_enqueue(tcb);
+  } else if (tcb->status == TASK_BLOCKED && tcb->wait_list) {
+    wait_list_remove(tcb->wait_list, tcb);
+    tcb->priority = priority;
+    wait_list_insert(tcb->wait_list, tcb);
+  } else {
+    tcb->priority = priority;
+  }
+}
+
+/**
+ * @brief Wake up the highest priority task of a wait list
+ * @retval the woken up task, NULL if no task is waiting
+ */
+ROS_TCB *ros_wake_first(ROS_TCB **wait_list, status_t status) {
+  ROS_TCB *tcb = *wait_list;
+  if (tcb) ros_wake(tcb, status);
+  return tcb;
+}
+
+void ros_int_enter() {
+#if ROS_IRQ_PROFILE
+  // the ISR may switch to a task which enables the interrupt
+  if (ros_int_cnt == 0) ros_irq_off_start = ROS_IRQ_PROFILE_TIME();
+#endif
+  ros_int_cnt++;
+  ROS_TRACE_EVENT(ROS_TRACE_ISR_ENTER, ros_int_cnt);
+}
+
+void ros_int_exit() {
+  ROS_TRACE_EVENT(ROS_TRACE_ISR_EXIT, ros_int_cnt);
+  ros_int_cnt--;
+  // keep running the current task if nothing above it is woken up, and its
+  // time slice is not used up. With the scheduler locked, ros_schedule()
+  // leaves it to ros_sched_unlock(). Only ros_schedule() from main() starts
+  // the os, not a tick before the tasks are all created.
+  if (need_schedule && current_tcb) ros_schedule();
+}
+
@@ -3,6 +3,7 @@
 
 #include "ros_port.h"
 #include "ros_timer.h"
+#include "ros_trace.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -12,7 +13,8 @@ typedef enum {
   TASK_READY = 0,
   // TASK_RUNNING,
   TASK_BLOCKED,
-  TASK_TERMINATED
+  TASK_TERMINATED,
+  TASK_SUSPENDED
 } Task_Status;
 
 /**
@@ -26,26 +28,105 @@ typedef enum {
  * }
  */
 typedef void (*task_func)();
+typedef uint8_t stack_t;
+
+struct ros_mutex;
 
 /**
- * Define the task control block using doubly linked list
- * while there is always a idle task in the list with priority 255.
+ * Define the task control block, next_tcb and prev_tcb link the tcb in the
+ * ready queue while there is always a idle task in the queue with priority
+ * MIN_TASK_PRIORITY. A blocked task is not in the ready queue, so they link it
+ * in the wait list of the kernel object it is waiting for. A suspended task is
+ * in neither of them.
  */
 typedef struct ros_tcb {
   void *sp;
   Task_Status status;
-  uint8_t priority;  // 0~255
+  uint8_t priority;  // 0~MIN_TASK_PRIORITY
+  // priority given at creation, priority may be raised above it by mutex
+  uint8_t base_priority;
   task_func task_entry;
-  // ROS_TCB *prev_tcb; //need doubly-list?
+  // the stack storage, painted with ROS_STACK_FILL
+  stack_t *stack;
+  uint16_t stack_size;
+  // doubly linked, so a task is removed from any list in O(1)
   struct ros_tcb *next_tcb;
+  struct ros_tcb *prev_tcb;
+  // wait list the task is blocked on, NULL if not waiting for any object
+  struct ros_tcb **wait_list;
+  // timeout timer of the blocked task, NULL if waiting forever
+  ROS_TIMER *timer;
+  // why the task is woken up: ROS_OK or ROS_ERR_TIMEOUT
+  status_t wait_status;
+#if ROS_MUTEXES
+  // mutexes held by the task, and the mutex it is blocked on
+  struct ros_mutex *held_mutex;
+  struct ros_mutex *wait_mutex;
+#endif
+#if ROS_EVENT_GROUPS
+  // event bits and options waiting for, the bits set when woken up
+  uint16_t event_bits;
+  uint8_t event_options;
+#endif
+  // ticks of a turn of round robin, 0 to run until it blocks or yields
+  uint8_t time_slice;
+  // ticks left of the current turn, 0 when the turn is over
+  uint8_t slice_left;
+#if ROS_TASK_NOTIFY
+  // notification value, and ROS_NOTIFY_NONE/PENDING/WAITING
+  uint32_t notify_value;
+  uint8_t notify_state;
+#endif
+  // periods skipped by ros_delay_until() because the deadline had passed, and
+  // with ROS_SCHED_EDF, jobs blocked after their absolute deadline
+  uint16_t deadline_misses;
+#if ROS_SCHED_EDF
+  // ticks from release(woken up) to the deadline, 0 for no deadline
+  uint32_t relative_deadline;
+  // sys tick of the deadline of the current job
+  uint32_t deadline;
+#endif
+  // links all the created tasks
+  struct ros_tcb *next_task;
+#if ROS_CPU_STATS
+  // ros_port_timestamp() counts the task has run, and times swapped in
+  uint32_t run_time;
+  uint32_t switch_count;
+#endif
+#if ROS_TRACE
+  // task id in the trace records, in order of creation: 0 is the idle task
+  uint8_t trace_id;
+#endif
 } ROS_TCB;
 
-typedef uint8_t stack_t;
 #define STACK_POINT(A, SIZE) (&A[SIZE - 1])
 
+/**
+ * Declare a task at compile time, the tcb is initialized in .data and the
+ * parameters are checked by the compiler. List all of them in a
+ * ROS_TASK_TABLE(), ros_init() sets them up and fills the ready queue at once,
+ * no ros_create_task() is needed:
+ *   ROS_TASK(task1, t1, 1, ROS_DEFAULT_STACK_SIZE);
+ *   ROS_TASK(task2, t2, 0, ROS_DEFAULT_STACK_SIZE);
+ *   ROS_TASK_TABLE(&task1, &task2);
+ */
+#define ROS_TASK(name, func, prio, size)                                   \
+  _Static_assert((prio) <= MIN_TASK_PRIORITY, "bad priority of " #name);  \
+  _Static_assert((size) >= ROS_MIN_STACK_SIZE, "small stack of " #name);  \
+  static stack_t name##_stack[size];                                       \
+  ROS_TCB name = {.status = TASK_READY,                                    \
+                  .priority = (prio),                                      \
+                  .base_priority = (prio),                                 \
+                  .time_slice = ROS_TIME_SLICE,                            \
+                  .task_entry = (func),                                    \
+                  .stack = name##_stack,                                   \
+                  .stack_size = (size)}
+#define ROS_TASK_TABLE(...) \
+  ROS_TCB *const ros_task_table[] = {__VA_ARGS__, NULL}
+
 // #define TRUE 1
 // #define FALSE 0
-#define MIN_TASK_PRIORITY 255
+#define MIN_TASK_PRIORITY (ROS_PRIORITY_LEVELS - 1)
 #define MAX_TASK_PRIORITY 0
 
 /* Error codes */
@@ -55,6 +136,13 @@ typedef uint8_t status_t;
 #define ROS_ERR_PARAM 200U
 #define ROS_ERR_CONTEXT 201U
 #define ROS_ERR_TIMER 201U
+#define ROS_ERR_TIMEOUT 202U
+#define ROS_ERR_FULL 203U
+#define ROS_ERR_DEADLINE 204U
+
+// timeout in ticks for blocking calls
+#define ROS_NO_WAIT 0U
+#define ROS_WAIT_FOREVER UINT32_MAX
 
 /*OS core functions: scheduler, context init, context switch and system tick*/
 
@@ -62,22 +150,55 @@ bool ros_init();
 ROS_TCB *ros_current_tcb();
 status_t ros_create_task(ROS_TCB *tcb, task_func task, uint8_t priority,
                          stack_t *stack, int stack_size);
+status_t ros_task_suspend(ROS_TCB *tcb);
+status_t ros_task_resume(ROS_TCB *tcb);
+status_t ros_task_delete(ROS_TCB *tcb);
 void ros_schedule();
+void ros_yield();
+void ros_sched_lock();
+void ros_sched_unlock();
+bool ros_sched_locked();
+status_t ros_task_set_time_slice(ROS_TCB *tcb, uint8_t ticks);
+uint16_t ros_task_stack_high_water(ROS_TCB *tcb);
+uint16_t ros_task_deadline_misses(ROS_TCB *tcb);
+#if ROS_SCHED_EDF
+status_t ros_task_set_deadline(ROS_TCB *tcb, uint32_t relative_deadline);
+#endif
+ROS_TCB *ros_task_next(ROS_TCB *tcb);
+#if ROS_CPU_STATS
+void ros_cpu_stats_reset();
+uint32_t ros_task_run_time(ROS_TCB *tcb);
+uint8_t ros_task_cpu_usage(ROS_TCB *tcb);
+#endif
+#if ROS_STACK_CHECK
+void ros_stack_overflow(ROS_TCB *tcb);
+#endif
 
 // list operations
 void ros_tcb_enqueue(ROS_TCB *tcb);
 ROS_TCB *ros_tcb_dequeue(uint8_t lowest_priority);
+void ros_tcb_remove(ROS_TCB *tcb);
+void ros_tcb_set_priority(ROS_TCB *tcb, uint8_t priority);
+
+// wait list operations for kernel objects, call with interrupt disabled
+status_t ros_wait(ROS_TCB **wait_list, uint32_t timeout);
+status_t ros_wait_timer(ROS_TIMER *timer);
+void ros_wake(ROS_TCB *tcb, status_t status);
+ROS_TCB *ros_wake_first(ROS_TCB **wait_list, status_t status);
 
 // call the following three functions from ISR
 void ros_int_enter();
 // define in ros_timer.c
 extern void ros_sys_tick();
+// called by ros_sys_tick(), charge the running task's time slice
+void ros_time_slice_tick(uint32_t ticks);
 void ros_int_exit();
 
 /* Global values and functions */
 
 extern bool ROS_STARTED;
-extern ROS_TCB *tcb_ready_list;
+// NULL terminated, see ROS_TASK_TABLE()
+extern ROS_TCB *const ros_task_table[];
 
 // define in ros_port.c for porting
 extern void ros_init_timer();
@@ -85,6 +206,19 @@ extern void ros_idle_task();
 extern void ros_task_context_init(ROS_TCB *tcb_ptr, task_func task_f,
                                   void *stack_top);
 extern void ros_switch_context(ROS_TCB *old_tcb, ROS_TCB *new_tcb);
+#if ROS_TICKLESS
+// called when the scheduler swaps out the idle task, interrupt disabled
+extern void ros_tickless_exit();
+#endif
+
+#if ROS_CPU_STATS || ROS_TRACE
+extern uint32_t ros_port_timestamp();
+#endif
+
+#if ROS_WORK_QUEUE
+// define in ros_work.c, create the work queue task
+extern status_t ros_work_start();
+#endif
 
 #ifdef __cplusplus
 }
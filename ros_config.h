@@ -0,0 +1,152 @@
+#ifndef __ROS_CONFIG_H__
+#define __ROS_CONFIG_H__
+
+/**
+ * Kernel configuration, edit it for your application or override any of them
+ * with -D. A feature turned off is not compiled in at all, the port specific
+ * settings(stack sizes, timestamp) are in ros_port.h.
+ */
+
+// System ticks pre-second, 100 means 1/100s(10ms) one tick
+#ifndef ROS_SYS_TICK
+#define ROS_SYS_TICK 100
+#endif
+
+// Number of task priorities(1~64), each one costs a list head and tail in the
+// ready queue. The lowest one(ROS_PRIORITY_LEVELS - 1) is the idle priority
+#ifndef ROS_PRIORITY_LEVELS
+#define ROS_PRIORITY_LEVELS 8
+#endif
+
+// Round robin among the ready tasks of the same priority: the running task
+// keeps the CPU for ROS_TIME_SLICE ticks before a peer gets its turn, and the
+// tick ISR skips the scheduler until then. 0 turns round robin off, a task runs
+// until it blocks or calls ros_yield(). Change it per task with
+// ros_task_set_time_slice()
+#ifndef ROS_TIME_SLICE
+#define ROS_TIME_SLICE 1
+#endif
+#if ROS_TIME_SLICE < 0 || ROS_TIME_SLICE > 255
+#error "ROS_TIME_SLICE should be 0~255"
+#endif
+
+// Earliest deadline first: the tasks of the same priority are ordered by
+// absolute deadline instead of round robin, set with ros_task_set_deadline().
+// Put the periodic tasks at one priority for pure EDF, the higher priorities
+// still preempt them
+#ifndef ROS_SCHED_EDF
+#define ROS_SCHED_EDF 0
+#endif
+
+// Tickless idle: the idle task stops the periodic tick and sleeps until the
+// next timer expires, ros_tickless_exit() catches up the ticks when it wakes
+#ifndef ROS_TICKLESS
+#define ROS_TICKLESS 0
+#endif
+
+// Deferred work queue(ros_work.c): ISRs submit work items, a kernel task runs
+// them at ROS_WORK_PRIORITY. It costs a task stack, the host port has it on
+#ifndef ROS_WORK_QUEUE
+#ifdef ROS_PORT_LINUX
+#define ROS_WORK_QUEUE 1
+#else
+#define ROS_WORK_QUEUE 0
+#endif
+#endif
+#ifndef ROS_WORK_PRIORITY
+#define ROS_WORK_PRIORITY 0
+#endif
+#ifndef ROS_WORK_STACK_SIZE
+#define ROS_WORK_STACK_SIZE ROS_DEFAULT_STACK_SIZE
+#endif
+
+// Software timers with callbacks(ros_soft_timer.c), run by the work queue
+#ifndef ROS_SOFT_TIMERS
+#define ROS_SOFT_TIMERS ROS_WORK_QUEUE
+#endif
+
+// Direct to task notification(ros_notify.c), costs 5 bytes in every tcb
+#ifndef ROS_TASK_NOTIFY
+#define ROS_TASK_NOTIFY 1
+#endif
+
+// Stackless coroutines(ros_coro.c), many state machines run in one host task
+// with a single stack. A coroutine waiting for a condition polls it every
+// ROS_CORO_POLL_TICKS ticks, or when ros_coro_signal() is called
+#ifndef ROS_COROUTINES
+#define ROS_COROUTINES ROS_TASK_NOTIFY
+#endif
+#ifndef ROS_CORO_POLL_TICKS
+#define ROS_CORO_POLL_TICKS 1
+#endif
+
+// Mutex(ros_mutex.c), costs two pointers in every tcb
+#ifndef ROS_MUTEXES
+#define ROS_MUTEXES 1
+#endif
+
+// Event flag group(ros_event.c), costs 3 bytes in every tcb
+#ifndef ROS_EVENT_GROUPS
+#define ROS_EVENT_GROUPS 1
+#endif
+
+// Time of day: ros_set_time(), ros_get_day_time() and ros_get_time(), the
+// fields are carried at every tick
+#ifndef ROS_TIME_OF_DAY
+#define ROS_TIME_OF_DAY 1
+#endif
+
+// Stacks are painted with ROS_STACK_FILL at creation. With ROS_STACK_CHECK,
+// the lowest ROS_STACK_GUARD_SIZE bytes are checked every time the task is
+// swapped out, and ros_stack_overflow() is called if any is overwritten
+#ifndef ROS_STACK_FILL
+#define ROS_STACK_FILL 0xA5
+#endif
+#ifndef ROS_STACK_CHECK
+#ifdef ROS_PORT_LINUX
+#define ROS_STACK_CHECK 1
+#else
+#define ROS_STACK_CHECK 0
+#endif
+#endif
+#ifndef ROS_STACK_GUARD_SIZE
+#define ROS_STACK_GUARD_SIZE 4
+#endif
+
+// Per-task CPU usage: run time is accumulated at every context switch with
+// ros_port_timestamp()
+#ifndef ROS_CPU_STATS
+#ifdef ROS_PORT_LINUX
+#define ROS_CPU_STATS 1
+#else
+#define ROS_CPU_STATS 0
+#endif
+#endif
+
+// Kernel event trace(ros_trace.c): context switch, ISR, delay and wakeup are
+// recorded in a ring of ROS_TRACE_SIZE(power of 2, up to 256) 4 bytes records,
+// time stamped with ROS_TRACE_TIME(), one more record every tick
+#ifndef ROS_TRACE
+#define ROS_TRACE 0
+#endif
+#ifndef ROS_TRACE_SIZE
+#define ROS_TRACE_SIZE 64
+#endif
+
+// Interrupt disabled time profiler(ros_irq_profile.c): every CRITICAL_STORE is
+// a site, its file and line are kept in flash and a byte in RAM. The
+// ROS_IRQ_PROFILE_SITES sites with the longest windows get a slot of
+// 2 * ROS_IRQ_PROFILE_BINS + 4 bytes of RAM, with the longest window and a
+// histogram of ROS_IRQ_PROFILE_BINS power of 2 bins. Nothing is compiled in
+// when it's off
+#ifndef ROS_IRQ_PROFILE
+#define ROS_IRQ_PROFILE 0
+#endif
+#ifndef ROS_IRQ_PROFILE_BINS
+#define ROS_IRQ_PROFILE_BINS 8
+#endif
+#ifndef ROS_IRQ_PROFILE_SITES
+#define ROS_IRQ_PROFILE_SITES 8
+#endif
+
+#endif  // __ROS_CONFIG_H__
@@ -0,0 +1,179 @@
+#include "ros_coro.h"
+#include "ros_notify.h"
+
+#if ROS_COROUTINES
+
+#if !ROS_TASK_NOTIFY
+#error "ROS_COROUTINES needs ROS_TASK_NOTIFY to wake up the host task"
+#endif
+
+// add a coroutine to the tail of the run queue
+static void run_queue_push(ROS_CORO_SCHED *sched, ROS_CORO *coro) {
+  coro->next = NULL;
+  // ros_coro_start() from another task may preempt the host task
+  ros_sched_lock();
+  if (sched->run_tail) {
+    sched->run_tail->next = coro;
+  } else {
+    sched->run_head = coro;
+  }
+  sched->run_tail = coro;
+  ros_sched_unlock();
+}
+
+static ROS_CORO *run_queue_pop(ROS_CORO_SCHED *sched) {
+  ros_sched_lock();
+  ROS_CORO *coro = sched->run_head;
+  if (coro) {
+    sched->run_head = coro->next;
+    if (sched->run_head == NULL) sched->run_tail = NULL;
+    coro->next = NULL;
+  }
+  ros_sched_unlock();
+  return coro;
+}
+
+/**
+ * @brief init a scheduler with no coroutine
+ * @param  *sched: the caller provides the scheduler storage
+ * @retval ROS_OK Success
+ * @retval ROS_ERR_PARAM Bad param
+ */
+status_t ros_coro_sched_init(ROS_CORO_SCHED *sched) {
+  if (sched == NULL) return ROS_ERR_PARAM;
+  sched->run_head = NULL;
+  sched->run_tail = NULL;
+  sched->sleep_list = NULL;
+  sched->host = NULL;
+  return ROS_OK;
+}
+
+/**
+ * @brief (Re)start a coroutine from its beginning, call it from a task or
+ * from another coroutine, but not from ISR. Don't start it again before it's
+ * done.
+ * @param  *coro: the caller provides the storage, usually embedded in the
+ * state of the coroutine
+ * @param  func: the coroutine, returns what the ROS_CORO_* macros return
+ * @retval ROS_OK Success
+ * @retval ROS_ERR_PARAM Bad param
+ */
+status_t ros_coro_start(ROS_CORO_SCHED *sched, ROS_CORO *coro,
+                        coro_func func) {
+  if (sched == NULL || coro == NULL || func == NULL) return ROS_ERR_PARAM;
+  coro->func = func;
+  coro->line = 0;
+  coro->state = ROS_CORO_READY;
+  coro->status = ROS_OK;
+  coro->forever = false;
+  run_queue_push(sched, coro);
+  ros_coro_signal(sched);
+  return ROS_OK;
+}
+
+/**
+ * @brief Wake up the host task to poll the waiting coroutines now, instead of
+ * at the next ROS_CORO_POLL_TICKS, e.g. after giving the semaphore one of them
+ * is waiting for. It's safe in ISR.
+ */
+void ros_coro_signal(ROS_CORO_SCHED *sched) {
+  ROS_TCB *host = sched->host;
+  if (host) ros_notify(host, 0, ROS_NOTIFY_INCREMENT);
+}
+
+/**
+ * @brief Set the wake tick of the wait to begin, called by the wait macros
+ * @param  timeout: ticks, or ROS_WAIT_FOREVER
+ */
+void ros_coro_wait_start(ROS_CORO *coro, uint32_t timeout) {
+  coro->forever = timeout == ROS_WAIT_FOREVER;
+  coro->wake = ros_get_sys_tick() + timeout;
+}
+
+// the wake tick of the last wait has come
+bool ros_coro_timed_out(ROS_CORO *coro) {
+  return !coro->forever && ros_deadline_reached(coro->wake);
+}
+
+// move the coroutines due and the waiting ones to the run queue
+static void wake_due(ROS_CORO_SCHED *sched) {
+  uint32_t now = ros_get_sys_tick();
+  ROS_CORO **link = &sched->sleep_list;
+  while (*link) {
+    ROS_CORO *coro = *link;
+    // a waiting one checks its condition and timeout again when resumed
+    if (coro->state == ROS_CORO_WAIT ||
+        (!coro->forever && !ros_time_before(now, coro->wake))) {
+      *link = coro->next;
+      run_queue_push(sched, coro);
+    } else {
+      link = &coro->next;
+    }
+  }
+}
+
+/**
+ * @retval ticks the host task can sleep: to the earliest wake tick, at most
+ * ROS_CORO_POLL_TICKS if a coroutine is waiting, ROS_WAIT_FOREVER if only
+ * ros_coro_signal() or ros_coro_start() brings more work
+ */
+static uint32_t idle_ticks(ROS_CORO_SCHED *sched) {
+  uint32_t now = ros_get_sys_tick();
+  uint32_t ticks = ROS_WAIT_FOREVER;
+  ROS_CORO *coro;
+  for (coro = sched->sleep_list; coro; coro = coro->next) {
+    if (coro->state == ROS_CORO_WAIT && ticks > ROS_CORO_POLL_TICKS) {
+      ticks = ROS_CORO_POLL_TICKS;
+    }
+    if (coro->forever) continue;
+    if (!ros_time_before(now, coro->wake)) return 0;
+    if (coro->wake - now < ticks) ticks = coro->wake - now;
+  }
+  return ticks;
+}
+
+// call the coroutine, and put it where its return value says
+static void resume(ROS_CORO_SCHED *sched, ROS_CORO *coro) {
+  coro->state = coro->func(coro);
+  if (coro->state == ROS_CORO_READY) {
+    run_queue_push(sched, coro);
+  } else if (coro->state != ROS_CORO_DONE) {
+    coro->next = sched->sleep_list;
+    sched->sleep_list = coro;
+  }
+}
+
+/**
+ * @brief Run the coroutines of the scheduler forever, in the current task,
+ * which becomes the host task. Every round resumes the ready coroutines once,
+ * then the host task sleeps until a sleeping coroutine is due, at most
+ * ROS_CORO_POLL_TICKS if one is waiting, or until ros_coro_signal(). The
+ * notification of the host task is taken by the scheduler.
+ */
+void ros_coro_run(ROS_CORO_SCHED *sched) {
+  if (sched == NULL || ros_current_tcb() == NULL) return;
+  sched->host = ros_current_tcb();
+  while (1) {
+    wake_due(sched);
+    // the yielding ones go to the tail, after the last one of this round
+    ros_sched_lock();
+    ROS_CORO *last = sched->run_tail;
+    ros_sched_unlock();
+    ROS_CORO *coro = NULL;
+    while (coro != last && (coro = run_queue_pop(sched))) resume(sched, coro);
+    // a pointer is two bytes on AVR, ros_coro_start() may tear the read
+    ros_sched_lock();
+    bool more = sched->run_head != NULL;
+    ros_sched_unlock();
+    if (more) {
+      // the peers of the host task get their turn
+      ros_yield();
+      continue;
+    }
+    uint32_t ticks = idle_ticks(sched);
+    // the signals so far are all served by the next round
+    if (ticks) ros_notify_wait(UINT32_MAX, NULL, ticks);
+  }
+}
+
+#endif  // ROS_COROUTINES
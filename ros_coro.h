@@ -0,0 +1,139 @@
+#ifndef __ROS_CORO_H__
+#define __ROS_CORO_H__
+
+#include "ros.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Stackless coroutines(protothreads): a coroutine is a function resumed at the
+ * line it returned from, by a switch on the line number. It has no stack of
+ * its own, so its locals are lost when it waits: keep the state in a struct
+ * embedding ROS_CORO. All the coroutines of a ROS_CORO_SCHED run in the one
+ * task calling ros_coro_run(), and never block it: the wait macros return to
+ * the scheduler instead, kernel objects are tried with ROS_NO_WAIT.
+ *
+ *   typedef struct { ROS_CORO coro; uint8_t led; } BLINKER;
+ *   uint8_t blink(ROS_CORO *coro) {
+ *     BLINKER *blinker = (BLINKER *)coro;
+ *     ROS_CORO_BEGIN(coro);
+ *     while (1) {
+ *       toggle(blinker->led);
+ *       ROS_CORO_DELAY(coro, 50);
+ *     }
+ *     ROS_CORO_END(coro);
+ *   }
+ *
+ * Don't put two wait macros on one line, or a wait macro inside a switch.
+ */
+
+// the coroutine returns it to the scheduler, it's the state of the coroutine
+#define ROS_CORO_READY 0  // run it again after the other ready ones
+#define ROS_CORO_SLEEP 1  // resume it when the wake tick comes
+#define ROS_CORO_WAIT 2   // poll it until it goes on, or the wake tick comes
+#define ROS_CORO_DONE 3   // returned from ROS_CORO_END or ROS_CORO_EXIT
+
+typedef struct ros_coro ROS_CORO;
+typedef uint8_t (*coro_func)(ROS_CORO *coro);
+
+struct ros_coro {
+  coro_func func;
+  // link in the run queue or the sleep list of the scheduler
+  struct ros_coro *next;
+  // sys tick to resume at, or to give up waiting
+  uint32_t wake;
+  // line number to resume at, 0 for the beginning
+  uint16_t line;
+  uint8_t state;
+  // result of the last wait: ROS_OK, ROS_ERR_TIMEOUT or the kernel call's
+  status_t status;
+  // the last wait has no timeout
+  bool forever;
+};
+
+typedef struct {
+  // FIFO of the ready coroutines, guarded by the scheduler lock
+  ROS_CORO *run_head;
+  ROS_CORO *run_tail;
+  // the sleeping and waiting ones, only the host task touches it
+  ROS_CORO *sleep_list;
+  // the task running the coroutines, it's notified by ros_coro_signal()
+  ROS_TCB *host;
+} ROS_CORO_SCHED;
+
+status_t ros_coro_sched_init(ROS_CORO_SCHED *sched);
+status_t ros_coro_start(ROS_CORO_SCHED *sched, ROS_CORO *coro, coro_func func);
+// safe to call from ISR
+void ros_coro_signal(ROS_CORO_SCHED *sched);
+void ros_coro_run(ROS_CORO_SCHED *sched);
+void ros_coro_wait_start(ROS_CORO *coro, uint32_t timeout);
+bool ros_coro_timed_out(ROS_CORO *coro);
+
+static inline bool ros_coro_done(ROS_CORO *coro) {
+  return coro->state == ROS_CORO_DONE;
+}
+
+#define ROS_CORO_BEGIN(coro) \
+  switch ((coro)->line) {    \
+    case 0:
+
+#define ROS_CORO_END(coro) \
+  }                        \
+  (coro)->line = 0;        \
+  return ROS_CORO_DONE
+
+// finish the coroutine from anywhere in it
+#define ROS_CORO_EXIT(coro) \
+  do {                      \
+    (coro)->line = 0;       \
+    return ROS_CORO_DONE;   \
+  } while (0)
+
+// remember where to resume, the next time it's called
+#define ROS_CORO_RESUME_HERE(coro) \
+  (coro)->line = __LINE__;         \
+  case __LINE__:
+
+// let the other ready coroutines run first
+#define ROS_CORO_YIELD(coro)     \
+  do {                           \
+    (coro)->line = __LINE__;     \
+    return ROS_CORO_READY;       \
+    case __LINE__:;              \
+  } while (0)
+
+// like ros_delay(), the other coroutines run meanwhile
+#define ROS_CORO_DELAY(coro, ticks)                          \
+  do {                                                       \
+    ros_coro_wait_start(coro, ticks);                        \
+    ROS_CORO_RESUME_HERE(coro);                              \
+    if (!ros_coro_timed_out(coro)) return ROS_CORO_SLEEP;    \
+  } while (0)
+
+/**
+ * Call a non-blocking kernel function until it doesn't return ROS_ERR_TIMEOUT,
+ * or timeout ticks pass, e.g.
+ *   ROS_CORO_AWAIT(coro, ros_sem_take(&sem, ROS_NO_WAIT), 100);
+ *   if (coro->status == ROS_OK) ...
+ * The result is left in coro->status.
+ */
+#define ROS_CORO_AWAIT(coro, call, timeout)                           \
+  do {                                                                \
+    ros_coro_wait_start(coro, timeout);                               \
+    ROS_CORO_RESUME_HERE(coro);                                       \
+    (coro)->status = (call);                                          \
+    if ((coro)->status == ROS_ERR_TIMEOUT && !ros_coro_timed_out(coro)) \
+      return ROS_CORO_WAIT;                                           \
+  } while (0)
+
+// wait until cond is true, coro->status is ROS_ERR_TIMEOUT if it's not in time
+#define ROS_CORO_WAIT_UNTIL(coro, cond, timeout) \
+  ROS_CORO_AWAIT(coro, (cond) ? ROS_OK : ROS_ERR_TIMEOUT, timeout)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  //__ROS_CORO_H__
@@ -0,0 +1,105 @@
+#include "ros_event.h"
+
+#if ROS_EVENT_GROUPS
+
+static inline bool satisfied(uint16_t bits, uint16_t wanted, uint8_t options) {
+  if (options & ROS_EVENT_ALL) return (bits & wanted) == wanted;
+  return (bits & wanted) != 0;
+}
+
+/**
+ * @brief init an event group with no bit set
+ * @param  *event: the caller provides the event group storage
+ * @retval ROS_OK Success
+ * @retval ROS_ERR_PARAM Bad param
+ */
+status_t ros_event_init(ROS_EVENT *event) {
+  if (event == NULL) return ROS_ERR_PARAM;
+  event->bits = 0;
+  event->wait_list = NULL;
+  return ROS_OK;
+}
+
+/**
+ * @brief wait until any or all of the bits are set, block current task until
+ * satisfied or timeout
+ * @param  bits: the bits to wait for
+ * @param  options: ROS_EVENT_ANY or ROS_EVENT_ALL, with ROS_EVENT_CLEAR
+ * @param  *value: nullable, the bits when satisfied, or current bits if timeout
+ * @param  timeout: ticks to wait, ROS_NO_WAIT or ROS_WAIT_FOREVER
+ * @retval ROS_OK Success
+ * @retval ROS_ERR_TIMEOUT not satisfied in timeout ticks
+ * @retval ROS_ERR_CONTEXT blocking in ISR
+ */
+status_t ros_event_wait(ROS_EVENT *event, uint16_t bits, uint8_t options,
+                        uint16_t *value, uint32_t timeout) {
+  status_t status;
+  uint16_t result;
+  if (event == NULL || bits == 0) return ROS_ERR_PARAM;
+  CRITICAL_STORE;
+  CRITICAL_START();
+  result = event->bits;
+  if (satisfied(result, bits, options)) {
+    if (options & ROS_EVENT_CLEAR) event->bits &= ~bits;
+    status = ROS_OK;
+  } else if (timeout == ROS_NO_WAIT) {
+    status = ROS_ERR_TIMEOUT;
+  } else {
+    ROS_TCB *cur_tcb = ros_current_tcb();
+    if (cur_tcb) {
+      cur_tcb->event_bits = bits;
+      cur_tcb->event_options = options;
+    }
+    status = ros_wait(&event->wait_list, timeout);
+    // the setter puts the bits to event_bits when we are satisfied
+    result = status == ROS_OK ? cur_tcb->event_bits : event->bits;
+  }
+  CRITICAL_END();
+  if (value) *value = result;
+  return status;
+}
+
+/**
+ * @brief set bits, and wake up every waiting task satisfied. The bits to clear
+ * for them are cleared after all the tasks are checked, so they all see the
+ * same bits. In ISR the woken up tasks will be scheduled at ros_int_exit()
+ * @retval ROS_OK Success
+ */
+status_t ros_event_set(ROS_EVENT *event, uint16_t bits) {
+  if (event == NULL) return ROS_ERR_PARAM;
+  CRITICAL_STORE;
+  CRITICAL_START();
+  uint16_t clear_bits = 0;
+  bool woken = false;
+  event->bits |= bits;
+  ROS_TCB *tcb = event->wait_list;
+  while (tcb) {
+    // ros_wake() unlinks tcb from the wait list
+    ROS_TCB *next = tcb->next_tcb;
+    if (satisfied(event->bits, tcb->event_bits, tcb->event_options)) {
+      if (tcb->event_options & ROS_EVENT_CLEAR) clear_bits |= tcb->event_bits;
+      tcb->event_bits = event->bits;
+      ros_wake(tcb, ROS_OK);
+      woken = true;
+    }
+    tcb = next;
+  }
+  event->bits &= ~clear_bits;
+  // no schedule in ISR, until ros_int_exit()
+  if (woken) ros_schedule();
+  CRITICAL_END();
+  return ROS_OK;
+}
+
+status_t ros_event_clear(ROS_EVENT *event, uint16_t bits) {
+  if (event == NULL) return ROS_ERR_PARAM;
+  CRITICAL_STORE;
+  CRITICAL_START();
+  event->bits &= ~bits;
+  CRITICAL_END();
+  return ROS_OK;
+}
+
+uint16_t ros_event_get(ROS_EVENT *event) { return event->bits; }
+
+#endif  // ROS_EVENT_GROUPS
@@ -0,0 +1,38 @@
+#ifndef __ROS_EVENT_H__
+#define __ROS_EVENT_H__
+
+#include "ros.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Event flag group, a task waits until any or all of the bits it wants are
+ * set. Setting bits wakes up all the satisfied tasks in one pass.
+ */
+typedef struct ros_event {
+  uint16_t bits;
+  // tasks waiting for bits, ordered by priority
+  ROS_TCB *wait_list;
+} ROS_EVENT;
+
+// wait options
+#define ROS_EVENT_ANY 0x00
+#define ROS_EVENT_ALL 0x01
+// clear the bits waited for when satisfied
+#define ROS_EVENT_CLEAR 0x02
+
+status_t ros_event_init(ROS_EVENT *event);
+status_t ros_event_wait(ROS_EVENT *event, uint16_t bits, uint8_t options,
+                        uint16_t *value, uint32_t timeout);
+// safe to call from ISR
+status_t ros_event_set(ROS_EVENT *event, uint16_t bits);
+status_t ros_event_clear(ROS_EVENT *event, uint16_t bits);
+uint16_t ros_event_get(ROS_EVENT *event);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  //__ROS_EVENT_H__
@@ -0,0 +1,103 @@
+// Interrupt disabled time profiler, see ros_irq_profile.h
+#include "ros.h"
+#include <string.h>
+
+#if ROS_IRQ_PROFILE
+
+uint16_t ros_irq_off_start;
+uint16_t ros_irq_off_top;
+// the sites measured so far, a NULL site is a free slot
+static ROS_IRQ_STATS site_stats[ROS_IRQ_PROFILE_SITES];
+
+/**
+ * @brief Account the window ending now to the site, called by CRITICAL_END()
+ * with interrupt still disabled
+ * @param  *site: the site in flash
+ * @param  *slot: the slot + 1 the site had last time, the slot may have been
+ * taken over by another site since
+ */
+void ros_irq_profile_record(const ROS_IRQ_SITE *site, uint8_t *slot) {
+  uint16_t now = ROS_IRQ_PROFILE_TIME();
+  uint32_t span = now >= ros_irq_off_start
+                      ? now - ros_irq_off_start
+                      : now + (ros_irq_off_top + 1UL) - ros_irq_off_start;
+  ROS_IRQ_STATS *stats;
+  uint8_t bin = 0;
+  if (span > UINT16_MAX) span = UINT16_MAX;
+  if (!*slot || site_stats[*slot - 1].site != site) {
+    // a free slot, or the one with the shortest longest window
+    uint8_t i, pick = 0;
+    for (i = 0; i < ROS_IRQ_PROFILE_SITES; i++) {
+      if (!site_stats[i].site) {
+        pick = i;
+        break;
+      }
+      if (site_stats[i].max < site_stats[pick].max) pick = i;
+    }
+    if (site_stats[pick].site && span <= site_stats[pick].max) {
+      *slot = 0;
+      return;
+    }
+    memset(&site_stats[pick], 0, sizeof(site_stats[pick]));
+    site_stats[pick].site = site;
+    *slot = pick + 1;
+  }
+  stats = &site_stats[*slot - 1];
+  if (span > stats->max) stats->max = span;
+  // the bit length of span, up to the last bin
+  while (span && bin < ROS_IRQ_PROFILE_BINS - 1) {
+    span >>= 1;
+    bin++;
+  }
+  if (stats->bins[bin] < UINT16_MAX) stats->bins[bin]++;
+}
+
+/**
+ * @brief Walk the sites measured so far:
+ *   for (s = ros_irq_profile_next(NULL); s; s = ros_irq_profile_next(s))
+ * @param  *stats: NULL for the first one
+ * @retval the next site, NULL at the end
+ */
+ROS_IRQ_STATS *ros_irq_profile_next(ROS_IRQ_STATS *stats) {
+  stats = stats ? stats + 1 : site_stats;
+  for (; stats < site_stats + ROS_IRQ_PROFILE_SITES; stats++) {
+    if (stats->site) return stats;
+  }
+  return NULL;
+}
+
+/**
+ * @retval the site with the longest window, which bounds the interrupt
+ * latency, NULL if none measured yet
+ */
+ROS_IRQ_STATS *ros_irq_profile_worst() {
+  ROS_IRQ_STATS *stats, *worst = NULL;
+  for (stats = ros_irq_profile_next(NULL); stats;
+       stats = ros_irq_profile_next(stats)) {
+    if (!worst || stats->max > worst->max) worst = stats;
+  }
+  return worst;
+}
+
+/**
+ * @retval the file name of the site, in flash on avr(printf_P() "%S")
+ */
+const char *ros_irq_profile_file(const ROS_IRQ_STATS *stats) {
+  return (const char *)ROS_PGM_READ_PTR(&stats->site->file);
+}
+
+uint16_t ros_irq_profile_line(const ROS_IRQ_STATS *stats) {
+  return ROS_PGM_READ_WORD(&stats->site->line);
+}
+
+/**
+ * @brief Forget all the sites, the slots are free again
+ */
+void ros_irq_profile_reset() {
+  CRITICAL_STORE;
+  CRITICAL_START();
+  memset(site_stats, 0, sizeof(site_stats));
+  CRITICAL_END();
+}
+
+#endif  // ROS_IRQ_PROFILE
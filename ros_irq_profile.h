@@ -0,0 +1,79 @@
+#ifndef __ROS_IRQ_PROFILE_H__
+#define __ROS_IRQ_PROFILE_H__
+
+/**
+ * Interrupt disabled time profiler, included by ros_port.h when
+ * ROS_IRQ_PROFILE is on. The CRITICAL_* macros time stamp the window from
+ * disabling the interrupt to enabling it again with ROS_IRQ_PROFILE_TIME()
+ * (TCNT1 on avr, 16us a count). Nested sections are part of the outer window,
+ * and a window across a context switch is credited to the section enabling
+ * the interrupt in the task swapped in. The ISRs themselves are not measured.
+ * Once the ROS_IRQ_PROFILE_SITES slots are taken, a site gets one only with a
+ * window longer than the shortest longest window, whose slot it takes over.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if ROS_IRQ_PROFILE_BINS < 2 || ROS_IRQ_PROFILE_BINS > 17
+#error "ROS_IRQ_PROFILE_BINS should be 2~17"
+#endif
+#if ROS_IRQ_PROFILE_SITES < 1 || ROS_IRQ_PROFILE_SITES > 254
+#error "ROS_IRQ_PROFILE_SITES should be 1~254"
+#endif
+
+/**
+ * A critical section site, one for every CRITICAL_STORE, kept in flash.
+ * Read it with ros_irq_profile_file() and ros_irq_profile_line().
+ */
+typedef struct ros_irq_site {
+  const char *file;
+  uint16_t line;
+} ROS_IRQ_SITE;
+
+/**
+ * The measured windows of a site, one of ROS_IRQ_PROFILE_SITES slots in RAM.
+ * Bin 0 counts the windows shorter than 1 count, bin n counts [2^(n-1), 2^n)
+ * and the last bin counts all the longer ones. The counts stop at UINT16_MAX.
+ */
+typedef struct ros_irq_stats {
+  const ROS_IRQ_SITE *site;
+  // the longest window, in ROS_IRQ_PROFILE_TIME() counts
+  uint16_t max;
+  uint16_t bins[ROS_IRQ_PROFILE_BINS];
+} ROS_IRQ_STATS;
+
+// define in ros_irq_profile.c, when the interrupt was disabled and the timer
+// top at that time, which tickless idle may change before the window ends
+extern uint16_t ros_irq_off_start;
+extern uint16_t ros_irq_off_top;
+
+void ros_irq_profile_record(const ROS_IRQ_SITE *site, uint8_t *slot);
+ROS_IRQ_STATS *ros_irq_profile_next(ROS_IRQ_STATS *stats);
+ROS_IRQ_STATS *ros_irq_profile_worst();
+const char *ros_irq_profile_file(const ROS_IRQ_STATS *stats);
+uint16_t ros_irq_profile_line(const ROS_IRQ_STATS *stats);
+void ros_irq_profile_reset();
+
+// the site in flash, and its slot + 1 in RAM, 0 for none yet
+#define CRITICAL_STORE                                                     \
+  uint8_t sreg;                                                            \
+  static const char irq_file[] ROS_PROGMEM = __FILE__;                     \
+  static const ROS_IRQ_SITE irq_site ROS_PROGMEM = {irq_file, __LINE__}; \
+  static uint8_t irq_slot
+#define CRITICAL_START()                          \
+  ROS_IRQ_DISABLE(sreg)                           \
+  if (ROS_IRQ_WAS_ENABLED(sreg)) {                \
+    ros_irq_off_start = ROS_IRQ_PROFILE_TIME();   \
+    ros_irq_off_top = ROS_IRQ_PROFILE_TOP();      \
+  }
+#define CRITICAL_END()                                                   \
+  if (ROS_IRQ_WAS_ENABLED(sreg)) ros_irq_profile_record(&irq_site, &irq_slot); \
+  ROS_IRQ_RESTORE(sreg)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __ROS_IRQ_PROFILE_H__
@@ -0,0 +1,150 @@
+#include "ros_mutex.h"
+
+#if ROS_MUTEXES
+
+/**
+ * @brief Recompute the priority of a task: its base priority, raised to the
+ * highest task waiting for any mutex it holds. If it is blocked on another
+ * mutex, the owner of that mutex is updated too, and so on.
+ * Interrupt should be disabled.
+ */
+static void update_priority(ROS_TCB *tcb) {
+  while (tcb) {
+    uint8_t priority = tcb->base_priority;
+    ROS_MUTEX *held;
+    for (held = tcb->held_mutex; held; held = held->next_held) {
+      // the wait list is ordered, the head is the highest
+      if (held->wait_list && held->wait_list->priority < priority) {
+        priority = held->wait_list->priority;
+      }
+    }
+    if (priority == tcb->priority) break;
+    ros_tcb_set_priority(tcb, priority);
+    tcb = tcb->wait_mutex ? tcb->wait_mutex->owner : NULL;
+  }
+}
+
+/**
+ * @brief Raise the owner to the priority of a new waiting task, and the owner
+ * of the mutex it is blocked on, and so on.
+ */
+static void inherit_priority(ROS_TCB *owner, uint8_t priority) {
+  while (owner && owner->priority > priority) {
+    ros_tcb_set_priority(owner, priority);
+    owner = owner->wait_mutex ? owner->wait_mutex->owner : NULL;
+  }
+}
+
+static void take_ownership(ROS_MUTEX *mutex, ROS_TCB *tcb) {
+  mutex->owner = tcb;
+  mutex->lock_count = 1;
+  mutex->next_held = tcb->held_mutex;
+  tcb->held_mutex = mutex;
+}
+
+static void release_ownership(ROS_MUTEX *mutex) {
+  ROS_MUTEX **link = &mutex->owner->held_mutex;
+  while (*link && *link != mutex) {
+    link = &(*link)->next_held;
+  }
+  if (*link) *link = mutex->next_held;
+  mutex->next_held = NULL;
+  mutex->owner = NULL;
+  mutex->lock_count = 0;
+}
+
+/**
+ * @brief init a mutex
+ * @param  *mutex: the caller provides the mutex storage
+ * @retval ROS_OK Success
+ * @retval ROS_ERR_PARAM Bad param
+ */
+status_t ros_mutex_init(ROS_MUTEX *mutex) {
+  if (mutex == NULL) return ROS_ERR_PARAM;
+  mutex->owner = NULL;
+  mutex->lock_count = 0;
+  mutex->wait_list = NULL;
+  mutex->next_held = NULL;
+  return ROS_OK;
+}
+
+/**
+ * @brief lock the mutex, the owner can lock it again. Block current task until
+ * it's unlocked or timeout, and the owner inherits current task's priority
+ * while waiting.
+ * @param  timeout: ticks to wait, ROS_NO_WAIT or ROS_WAIT_FOREVER
+ * @retval ROS_OK Success
+ * @retval ROS_ERR_TIMEOUT the mutex is not unlocked in timeout ticks
+ * @retval ROS_ERR_CONTEXT not in a task
+ * @retval ROS_ERROR locked too many times
+ */
+status_t ros_mutex_lock(ROS_MUTEX *mutex, uint32_t timeout) {
+  status_t status;
+  if (mutex == NULL) return ROS_ERR_PARAM;
+  ROS_TCB *cur_tcb = ros_current_tcb();
+  if (cur_tcb == NULL) return ROS_ERR_CONTEXT;
+  CRITICAL_STORE;
+  CRITICAL_START();
+  if (mutex->owner == NULL) {
+    take_ownership(mutex, cur_tcb);
+    status = ROS_OK;
+  } else if (mutex->owner == cur_tcb) {
+    if (mutex->lock_count == UINT8_MAX) {
+      status = ROS_ERROR;
+    } else {
+      mutex->lock_count++;
+      status = ROS_OK;
+    }
+  } else if (timeout == ROS_NO_WAIT) {
+    status = ROS_ERR_TIMEOUT;
+  } else {
+    cur_tcb->wait_mutex = mutex;
+    inherit_priority(mutex->owner, cur_tcb->priority);
+    status = ros_wait(&mutex->wait_list, timeout);
+    cur_tcb->wait_mutex = NULL;
+    // the unlocker hands the mutex to us, or give up the inheritance
+    if (status != ROS_OK) update_priority(mutex->owner);
+  }
+  CRITICAL_END();
+  return status;
+}
+
+/**
+ * @brief unlock the mutex, hand it to the highest priority waiting task when
+ * the lock count drops to 0, and restore the priority of current task
+ * @retval ROS_OK Success
+ * @retval ROS_ERROR current task is not the owner
+ */
+status_t ros_mutex_unlock(ROS_MUTEX *mutex) {
+  if (mutex == NULL) return ROS_ERR_PARAM;
+  ROS_TCB *cur_tcb = ros_current_tcb();
+  if (cur_tcb == NULL || mutex->owner != cur_tcb) return ROS_ERROR;
+  CRITICAL_STORE;
+  CRITICAL_START();
+  if (--mutex->lock_count == 0) {
+    release_ownership(mutex);
+    ROS_TCB *next = ros_wake_first(&mutex->wait_list, ROS_OK);
+    if (next) {
+      next->wait_mutex = NULL;
+      take_ownership(mutex, next);
+      // it may inherit from the rest waiting tasks
+      update_priority(next);
+    }
+    update_priority(cur_tcb);
+    ros_schedule();
+  }
+  CRITICAL_END();
+  return ROS_OK;
+}
+
+/**
+ * @brief A task blocked on a mutex is suspended or deleted, the owner gives
+ * up the priority inherited from it. Interrupt should be disabled.
+ */
+void ros_mutex_wait_cancel(ROS_TCB *tcb) {
+  ROS_MUTEX *mutex = tcb->wait_mutex;
+  tcb->wait_mutex = NULL;
+  if (mutex) update_priority(mutex->owner);
+}
+
+#endif  // ROS_MUTEXES
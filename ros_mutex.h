@@ -0,0 +1,35 @@
+#ifndef __ROS_MUTEX_H__
+#define __ROS_MUTEX_H__
+
+#include "ros.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Recursive mutex with priority inheritance: while a task is waiting, the
+ * owner runs at the priority of the highest waiting task, so a middle priority
+ * task can't preempt it for unbounded time. Only for tasks, not for ISR.
+ */
+typedef struct ros_mutex {
+  ROS_TCB *owner;
+  // times the owner locked the mutex
+  uint8_t lock_count;
+  // tasks waiting for the mutex, ordered by priority
+  ROS_TCB *wait_list;
+  // next mutex held by the same owner
+  struct ros_mutex *next_held;
+} ROS_MUTEX;
+
+status_t ros_mutex_init(ROS_MUTEX *mutex);
+status_t ros_mutex_lock(ROS_MUTEX *mutex, uint32_t timeout);
+status_t ros_mutex_unlock(ROS_MUTEX *mutex);
+// the task gives up waiting for its wait_mutex, call with interrupt disabled
+void ros_mutex_wait_cancel(ROS_TCB *tcb);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  //__ROS_MUTEX_H__
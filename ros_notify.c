@@ -0,0 +1,126 @@
+#include "ros_notify.h"
+
+#if ROS_TASK_NOTIFY
+
+/**
+ * @brief Block current task until it's notified, interrupt disabled.
+ * Only ros_notify() wakes it up, no wait list is walked.
+ * @retval ROS_ERR_CONTEXT the scheduler is locked, nothing is changed
+ */
+static status_t notify_block(ROS_TCB *tcb, uint32_t timeout) {
+  uint8_t state = tcb->notify_state;
+  tcb->notify_state = ROS_NOTIFY_WAITING;
+  if (ros_wait(NULL, timeout) == ROS_ERR_CONTEXT) {
+    tcb->notify_state = state;
+    return ROS_ERR_CONTEXT;
+  }
+  // notified after the timeout expired, but before we run again
+  if (tcb->notify_state == ROS_NOTIFY_PENDING) return ROS_OK;
+  tcb->notify_state = ROS_NOTIFY_NONE;
+  return ROS_ERR_TIMEOUT;
+}
+
+/**
+ * @brief Notify a task: update its notification value and wake it up if it's
+ * waiting for it. In ISR the woken up task will be scheduled at ros_int_exit()
+ * @param  *tcb: the task to notify
+ * @param  value: bits to set, or the new value, see the actions
+ * @param  action: ROS_NOTIFY_SET_BITS, ROS_NOTIFY_INCREMENT,
+ * ROS_NOTIFY_OVERWRITE or ROS_NOTIFY_NO_OVERWRITE
+ * @retval ROS_OK Success
+ * @retval ROS_ERR_FULL ROS_NOTIFY_NO_OVERWRITE and the last one is not read
+ * @retval ROS_ERR_PARAM Bad param
+ */
+status_t ros_notify(ROS_TCB *tcb, uint32_t value, uint8_t action) {
+  status_t status = ROS_OK;
+  if (tcb == NULL || action > ROS_NOTIFY_NO_OVERWRITE) return ROS_ERR_PARAM;
+  CRITICAL_STORE;
+  CRITICAL_START();
+  switch (action) {
+    case ROS_NOTIFY_SET_BITS:
+      tcb->notify_value |= value;
+      break;
+    case ROS_NOTIFY_INCREMENT:
+      tcb->notify_value++;
+      break;
+    case ROS_NOTIFY_NO_OVERWRITE:
+      if (tcb->notify_state == ROS_NOTIFY_PENDING) {
+        status = ROS_ERR_FULL;
+        break;
+      }
+      // fall through
+    default:
+      tcb->notify_value = value;
+      break;
+  }
+  if (status == ROS_OK) {
+    bool waiting = tcb->notify_state == ROS_NOTIFY_WAITING;
+    tcb->notify_state = ROS_NOTIFY_PENDING;
+    if (waiting) {
+      ros_wake(tcb, ROS_OK);
+      // no schedule in ISR, until ros_int_exit()
+      ros_schedule();
+    }
+  }
+  CRITICAL_END();
+  return status;
+}
+
+/**
+ * @brief Wait until current task is notified, and read the value
+ * @param  clear_bits: bits of the value to clear after reading it, UINT32_MAX
+ * to reset it to 0
+ * @param  *value: to store the value, nullable
+ * @param  timeout: ticks to wait, ROS_NO_WAIT or ROS_WAIT_FOREVER
+ * @retval ROS_OK Success
+ * @retval ROS_ERR_TIMEOUT not notified in timeout ticks
+ * @retval ROS_ERR_CONTEXT not in a task, or the scheduler is locked
+ */
+status_t ros_notify_wait(uint32_t clear_bits, uint32_t *value,
+                         uint32_t timeout) {
+  status_t status = ROS_OK;
+  ROS_TCB *tcb = ros_current_tcb();
+  if (tcb == NULL) return ROS_ERR_CONTEXT;
+  CRITICAL_STORE;
+  CRITICAL_START();
+  if (tcb->notify_state != ROS_NOTIFY_PENDING) {
+    status = timeout == ROS_NO_WAIT ? ROS_ERR_TIMEOUT
+                                    : notify_block(tcb, timeout);
+  }
+  if (status == ROS_OK) {
+    if (value) *value = tcb->notify_value;
+    tcb->notify_value &= ~clear_bits;
+    tcb->notify_state = ROS_NOTIFY_NONE;
+  }
+  CRITICAL_END();
+  return status;
+}
+
+/**
+ * @brief Take one count of the notification value, like a counting semaphore
+ * given by ros_notify(tcb, 0, ROS_NOTIFY_INCREMENT)
+ * @param  timeout: ticks to wait, ROS_NO_WAIT or ROS_WAIT_FOREVER
+ * @retval ROS_OK Success
+ * @retval ROS_ERR_TIMEOUT not notified in timeout ticks
+ * @retval ROS_ERR_CONTEXT not in a task, or the scheduler is locked
+ */
+status_t ros_notify_take(uint32_t timeout) {
+  status_t status = ROS_OK;
+  ROS_TCB *tcb = ros_current_tcb();
+  if (tcb == NULL) return ROS_ERR_CONTEXT;
+  CRITICAL_STORE;
+  CRITICAL_START();
+  if (tcb->notify_state != ROS_NOTIFY_PENDING) {
+    status = timeout == ROS_NO_WAIT ? ROS_ERR_TIMEOUT
+                                    : notify_block(tcb, timeout);
+  }
+  if (status == ROS_OK) {
+    if (tcb->notify_value) tcb->notify_value--;
+    // still pending until the count goes down to 0
+    if (tcb->notify_value == 0) tcb->notify_state = ROS_NOTIFY_NONE;
+  }
+  CRITICAL_END();
+  return status;
+}
+
+#endif  // ROS_TASK_NOTIFY
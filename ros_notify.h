@@ -0,0 +1,39 @@
+#ifndef __ROS_NOTIFY_H__
+#define __ROS_NOTIFY_H__
+
+#include "ros.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Direct to task notification: a 32 bits value in the tcb of the receiving
+ * task, so one ISR waking up one task needs no semaphore or queue. The value
+ * works as event bits, a counter or a mailbox of one item, by the action given
+ * to ros_notify().
+ */
+
+// notify actions
+#define ROS_NOTIFY_SET_BITS 0   // or the value into it
+#define ROS_NOTIFY_INCREMENT 1  // add one to it, the value is not used
+#define ROS_NOTIFY_OVERWRITE 2  // replace it
+// replace it only if the task has read the last one, or ROS_ERR_FULL
+#define ROS_NOTIFY_NO_OVERWRITE 3
+
+// notify_state of the tcb
+#define ROS_NOTIFY_NONE 0
+#define ROS_NOTIFY_PENDING 1
+#define ROS_NOTIFY_WAITING 2
+
+// safe to call from ISR
+status_t ros_notify(ROS_TCB *tcb, uint32_t value, uint8_t action);
+status_t ros_notify_wait(uint32_t clear_bits, uint32_t *value,
+                         uint32_t timeout);
+status_t ros_notify_take(uint32_t timeout);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  //__ROS_NOTIFY_H__
@@ -2,19 +2,143 @@
 #include "ros.h"
 /*specific port file for Arduino Uno */
 
+// Timer1 counts in one tick
+#define TICK_COUNTS (F_CPU / 256 / ROS_SYS_TICK)
+
 static void init_timer1() {
   // Set prescaler 256
   TCCR1B = _BV(CS12) | _BV(WGM12);
   // For Arduino Uno CPU 16000000 HZ, so the OCR1A should count from 0 to 624
   // x * 1/16M * 256 = 10 ms = 0.01 s
   // x = 16 M / 100 / 256 = 625
-  OCR1A = (F_CPU / 256 / ROS_SYS_TICK) - 1;
+  OCR1A = TICK_COUNTS - 1;
   // enable compare match 1A interrupt
   TIMSK1 = _BV(OCIE1A);
 }
 
 void ros_init_timer() { init_timer1(); }
 
+#if ROS_TICKLESS
+// the longest compare period of the 16 bits Timer1, 104 ticks for 100HZ tick
+#define TICKLESS_MAX_TICKS (65536UL / TICK_COUNTS)
+
+// ticks of the stretched compare period, 0 if Timer1 is ticking normally
+static volatile uint8_t tickless_end = 0;
+// ticks of the period already announced by ros_tickless_exit()
+static volatile uint8_t tickless_announced = 0;
+
+/**
+ * @brief Stretch the current tick period to the next timer expiry. A longer
+ * delay is chained: wake up at TICKLESS_MAX_TICKS, then sleep again.
+ * Interrupt should be disabled.
+ */
+static void tickless_enter() {
+  uint32_t ticks = ros_timer_next_expiry();
+  uint8_t old_end = tickless_end;
+  if (ticks <= 1) return;
+  // TCNT1 counts from the beginning of the period, which may be a stretched
+  // one ros_tickless_exit() has announced a part of: it goes on, and the
+  // sys tick is tickless_announced ticks into it
+  ticks += tickless_announced;
+  if (ticks > TICKLESS_MAX_TICKS) ticks = TICKLESS_MAX_TICKS;
+  // it never ends before the current end, which is ahead of TCNT1
+  if (ticks <= old_end) return;
+  OCR1A = ticks * TICK_COUNTS - 1;
+  tickless_end = ticks;
+  // the compare matched before OCR1A was written, let the ISR announce the
+  // period as it was
+  if (TIFR1 & _BV(OCF1A)) {
+    OCR1A = (old_end ? old_end : 1) * TICK_COUNTS - 1;
+    tickless_end = old_end;
+  }
+}
+
+/**
+ * @brief Woken up before the stretched period ends: announce the elapsed
+ * ticks, and end the period at the next tick boundary. Nothing expires here,
+ * because the period is no longer than the next timer expiry.
+ * Interrupt should be disabled.
+ */
+void ros_tickless_exit() {
+  if (tickless_end == 0) return;
+  // the period is over, the ISR will announce it
+  if (TIFR1 & _BV(OCF1A)) return;
+  uint16_t count = TCNT1;
+  uint8_t elapsed = count / TICK_COUNTS;
+  uint8_t end = elapsed + 1;
+  // too close to the boundary to write OCR1A in time, end at the next one
+  if (count - elapsed * TICK_COUNTS >= TICK_COUNTS - 2) end++;
+  if (end > tickless_end) end = tickless_end;
+  OCR1A = end * TICK_COUNTS - 1;
+  tickless_end = end;
+  if (elapsed > tickless_announced) {
+    ros_sys_tick_advance(elapsed - tickless_announced);
+    tickless_announced = elapsed;
+  }
+}
+#endif
+
+/**
+ * @brief TCNT1 and the sys tick it counts from, interrupt should be disabled.
+ * A pending compare match means the period is over and TCNT1 restarts, but the
+ * ISR hasn't counted it yet: the ticks it will announce are counted here, so
+ * the time never goes backwards.
+ * @param  *ticks: ticks to add to the sys tick to get the one TCNT1 counts from
+ * @retval Timer1 counts since that tick
+ */
+static uint16_t tick_count(int16_t *ticks) {
+  uint16_t count = TCNT1;
+  *ticks = 0;
+#if ROS_TICKLESS
+  // TCNT1 counts from the beginning of the stretched period
+  *ticks -= tickless_announced;
+#endif
+  if (TIFR1 & _BV(OCF1A)) {
+    count = TCNT1;
+#if ROS_TICKLESS
+    *ticks += tickless_end ? tickless_end : 1;
+#else
+    (*ticks)++;
+#endif
+  }
+  return count;
+}
+
+// Timer1 counts to microseconds, prescaler 256
+#define COUNTS_TO_US(count) ((uint32_t)(count) * 256UL / (F_CPU / 1000000UL))
+#define TICK_US (1000000UL / ROS_SYS_TICK)
+
+/**
+ * @brief Microseconds since the os started, the sys tick plus TCNT1 in
+ * 16us(16MHz) steps. The 64 bits multiply costs more than
+ * ros_port_timestamp(), but it never wraps around.
+ */
+uint64_t ros_time_us() {
+  CRITICAL_STORE;
+  CRITICAL_START();
+  int16_t ticks;
+  uint16_t count = tick_count(&ticks);
+  uint64_t now = ros_get_sys_tick64() + ticks;
+  CRITICAL_END();
+  return now * TICK_US + COUNTS_TO_US(count);
+}
+
+#if ROS_CPU_STATS
+/**
+ * @brief Timer1 counts(16us) since the os started, TCNT1 is the sub-tick part.
+ * It wraps in 19 hours, just use the difference of two timestamps.
+ */
+uint32_t ros_port_timestamp() {
+  CRITICAL_STORE;
+  CRITICAL_START();
+  int16_t ticks;
+  uint16_t count = tick_count(&ticks);
+  uint32_t now = ros_get_sys_tick() + ticks;
+  CRITICAL_END();
+  return now * TICK_COUNTS + count;
+}
+#endif
+
 /**
  * @brief The idle task takes advantage of atmega328p's sleep mode, sleep when
  * there is no task to run
@@ -22,7 +146,21 @@ void ros_init_timer() { init_timer1(); }
 void ros_idle_task() {
   set_sleep_mode(SLEEP_MODE_IDLE);
   while (1) {
+#if ROS_TICKLESS
+    cli();
+    tickless_enter();
+    sleep_enable();
+    // the instruction after sei is always executed, so no interrupt is lost
+    // before sleep
+    sei();
+    sleep_cpu();
+    sleep_disable();
+    cli();
+    ros_tickless_exit();
+    sei();
+#else
     sleep_mode();
+#endif
   }
 }
 
@@ -162,8 +300,29 @@ void ros_switch_context(ROS_TCB *old_tcb, ROS_TCB *new_tcb) {
 
 // interrupt every SYS_TICK to re-schedule tasks
 ISR(TIMER1_COMPA_vect) {
+#if ROS_TRACE
+  // before anything else in the new period, so the trace time goes on. The
+  // period begins at the sys tick to be advanced to, in Timer1 counts.
+#if ROS_TICKLESS
+  uint8_t advance = tickless_end ? tickless_end - tickless_announced : 1;
+  ROS_TRACE_TICK_EVENT((ros_get_sys_tick() + advance) * TICK_COUNTS,
+                       tickless_end ? tickless_end : 1);
+#else
+  ROS_TRACE_TICK_EVENT((ros_get_sys_tick() + 1) * TICK_COUNTS, 1);
+#endif
+#endif
   ros_int_enter();
+#if ROS_TICKLESS
+  if (tickless_end) {
+    uint8_t ticks = tickless_end - tickless_announced;
+    // back to one tick period
+    OCR1A = TICK_COUNTS - 1;
+    tickless_end = 0;
+    tickless_announced = 0;
+    ros_sys_tick_advance(ticks);
+  } else
+#endif
   ros_sys_tick();
   // exit ISR, ready to call scheduler
   ros_int_exit();
-}
\ No newline at end of file
+}
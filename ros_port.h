@@ -10,43 +10,114 @@
 #endif  // ARDUINO
 */
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ros_config.h"
+
+#ifndef ROS_PORT_LINUX
 /**
  * include with avr-libc for uintX_t and bool
  */
 #include <avr/interrupt.h>
 #include <avr/io.h>
+#include <avr/pgmspace.h>
 #include <avr/sleep.h>
-#include <stdbool.h>
-#include <stddef.h>
-#include <stdint.h>
+#endif
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+#ifndef ROS_PORT_LINUX
 /**
  * Because the interrupt flag is stored in SREG, so we save the old SREG, then
  * disable interrupt to do critical codes. After calling CRITICAL_END(), the
  * interrupt flag restored either enable or diable.
  */
-#define CRITICAL_STORE uint8_t sreg
-#define CRITICAL_START() \
-  sreg = SREG;           \
+#define ROS_IRQ_DISABLE(sreg) \
+  sreg = SREG;                \
   cli();
-#define CRITICAL_END() SREG = sreg;
+#define ROS_IRQ_RESTORE(sreg) SREG = sreg;
+#define ROS_IRQ_WAS_ENABLED(sreg) ((sreg) & _BV(SREG_I))
 
 #ifndef F_CPU
 // Atmega328p CPU frequency is 16MHZ
 #define F_CPU 16000000UL
 #endif
 
-// System ticks pre-second, 100 means 1/100s(10ms) one tick
-#define ROS_SYS_TICK 100
-
 #define ROS_IDLE_STACK_SIZE 64
 #define ROS_DEFAULT_STACK_SIZE 128
 #define ROS_MIN_STACK_SIZE 32
 
+// trace time, Timer1 counts from the beginning of the tick period
+#define ROS_TRACE_TIME() TCNT1
+// interrupt disabled time, Timer1 restarts from 0 after counting to OCR1A
+#define ROS_IRQ_PROFILE_TIME() TCNT1
+#define ROS_IRQ_PROFILE_TOP() OCR1A
+
+// constant data kept in flash, read back with pgm_read_word()
+#define ROS_PROGMEM PROGMEM
+#define ROS_PGM_READ_WORD(addr) pgm_read_word(addr)
+#define ROS_PGM_READ_PTR(addr) ((const void *)(uintptr_t)pgm_read_word(addr))
+
+#else  // ROS_PORT_LINUX
+/**
+ * Linux user space port (ros_port_linux.c), the "interrupt" is the SIGALRM
+ * tick signal. Disabling interrupt means blocking SIGALRM, and the old "SREG"
+ * is whether SIGALRM was unblocked before.
+ */
+uint8_t ros_port_irq_save();
+void ros_port_irq_restore(uint8_t sreg);
+#define ROS_IRQ_DISABLE(sreg) sreg = ros_port_irq_save();
+#define ROS_IRQ_RESTORE(sreg) ros_port_irq_restore(sreg);
+#define ROS_IRQ_WAS_ENABLED(sreg) (sreg)
+
+// The signal frame is pushed on the interrupted task's stack, so the host
+// stacks have to be much bigger than the avr ones
+#define ROS_IDLE_STACK_SIZE 16384
+#define ROS_DEFAULT_STACK_SIZE 16384
+#define ROS_MIN_STACK_SIZE 8192
+
+// trace time, microseconds since the last tick signal
+uint16_t ros_port_trace_time();
+#define ROS_TRACE_TIME() ros_port_trace_time()
+// interrupt disabled time, the low 16 bits of the microsecond timestamp
+uint32_t ros_port_timestamp();
+#define ROS_IRQ_PROFILE_TIME() ((uint16_t)ros_port_timestamp())
+#define ROS_IRQ_PROFILE_TOP() 0xFFFF
+
+// flash and RAM are one address space
+#define ROS_PROGMEM
+#define ROS_PGM_READ_WORD(addr) (*(addr))
+#define ROS_PGM_READ_PTR(addr) ((const void *)*(addr))
+#endif  // ROS_PORT_LINUX
+
+/**
+ * CRITICAL_STORE declares the saved interrupt state, CRITICAL_START() disables
+ * interrupt and CRITICAL_END() restores it. With ROS_IRQ_PROFILE they also
+ * measure every interrupt disabled window, see ros_irq_profile.h
+ */
+#if ROS_IRQ_PROFILE
+#include "ros_irq_profile.h"
+#else
+#define CRITICAL_STORE uint8_t sreg
+#define CRITICAL_START() ROS_IRQ_DISABLE(sreg)
+#define CRITICAL_END() ROS_IRQ_RESTORE(sreg)
+#endif
+
+// Compiler memory barrier, for the data shared with ISR without disabling
+// interrupt
+#define ROS_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+// Counts per second of ros_port_timestamp()
+#ifdef ROS_PORT_LINUX
+#define ROS_TIMESTAMP_HZ 1000000UL
+#else
+#define ROS_TIMESTAMP_HZ (F_CPU / 256)
+#endif
+
 #ifdef __cplusplus
 }
 #endif
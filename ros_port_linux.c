@@ -0,0 +1,330 @@
+/*specific port file for Linux user space, build with `make PORT=linux` */
+
+// <signal.h> has its own stack_t(for sigaltstack), which we never use here,
+// rename it to avoid the conflict with the stack_t in ros.h
+#define stack_t ros_sig_stack_t
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+#undef stack_t
+
+#include "ros_port.h"
+#include "ros.h"
+
+static sigset_t tick_sigset;
+// CLOCK_MONOTONIC when the os started
+static struct timespec start_time;
+
+/**
+ * @brief Disable the "interrupt", by blocking the tick signal
+ * @retval 1 if the tick signal is unblocked before, which is the I-bit of SREG
+ */
+uint8_t ros_port_irq_save() {
+  sigset_t old_set;
+  sigprocmask(SIG_BLOCK, &tick_sigset, &old_set);
+  return !sigismember(&old_set, SIGALRM);
+}
+
+void ros_port_irq_restore(uint8_t sreg) {
+  if (sreg) sigprocmask(SIG_UNBLOCK, &tick_sigset, NULL);
+}
+
+#define TICK_USEC (1000000L / ROS_SYS_TICK)
+
+#if ROS_TICKLESS
+// ticks to announce at next signal, 0 if the timer is ticking normally
+static volatile uint32_t tickless_ticks = 0;
+#endif
+
+#if ROS_TRACE
+// ros_port_timestamp() of the last tick signal
+static uint32_t tick_stamp;
+
+// a stretched period is longer than 16 bits of microseconds, but only the
+// idle task runs in it, and it records nothing after going to sleep
+uint16_t ros_port_trace_time() {
+  uint32_t time = ros_port_timestamp() - tick_stamp;
+  return time > 0xFFFF ? 0xFFFF : time;
+}
+
+// begin a tick period, like Timer1 restarting from 0
+static void trace_tick() {
+  uint32_t now = ros_port_timestamp();
+  uint32_t ticks = (now - tick_stamp + TICK_USEC / 2) / TICK_USEC;
+  tick_stamp = now;
+  ROS_TRACE_TICK_EVENT(now, ticks);
+}
+#endif
+
+// interrupt every SYS_TICK to re-schedule tasks, same as the Timer1 ISR
+static void tick_handler(int sig) {
+  int saved_errno = errno;
+  (void)sig;
+#if ROS_TRACE
+  trace_tick();
+#endif
+  ros_int_enter();
+#if ROS_TICKLESS
+  if (tickless_ticks) {
+    uint32_t ticks = tickless_ticks;
+    // it_interval reloads one tick period by itself
+    tickless_ticks = 0;
+    ros_sys_tick_advance(ticks);
+  } else
+#endif
+  ros_sys_tick();
+  // exit ISR, ready to call scheduler
+  ros_int_exit();
+  errno = saved_errno;
+}
+
+static void init_tick_timer() {
+  struct sigaction sa;
+  struct itimerval timer;
+
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = tick_handler;
+  sigemptyset(&sa.sa_mask);
+  sa.sa_flags = SA_RESTART;
+  sigaction(SIGALRM, &sa, NULL);
+
+  timer.it_interval.tv_sec = 0;
+  timer.it_interval.tv_usec = TICK_USEC;
+  timer.it_value = timer.it_interval;
+  setitimer(ITIMER_REAL, &timer, NULL);
+}
+
+void ros_init_timer() {
+  sigemptyset(&tick_sigset);
+  sigaddset(&tick_sigset, SIGALRM);
+  clock_gettime(CLOCK_MONOTONIC, &start_time);
+#if ROS_TRACE
+  tick_stamp = ros_port_timestamp();
+#endif
+  init_tick_timer();
+}
+
+/**
+ * @brief Microseconds since the os started. There is no counter in step with
+ * the tick signal, it's read from CLOCK_MONOTONIC instead.
+ */
+uint64_t ros_time_us() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)(now.tv_sec - start_time.tv_sec) * 1000000ULL +
+         (now.tv_nsec - start_time.tv_nsec) / 1000;
+}
+
+#if ROS_CPU_STATS || ROS_TRACE || ROS_IRQ_PROFILE
+/**
+ * @brief Microseconds since an arbitrary point, it wraps in 71 minutes, just
+ * use the difference of two timestamps.
+ */
+uint32_t ros_port_timestamp() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint32_t)now.tv_sec * 1000000UL + now.tv_nsec / 1000;
+}
+#endif
+
+#if ROS_TICKLESS
+static bool tick_pending() {
+  sigset_t pending;
+  sigpending(&pending);
+  return sigismember(&pending, SIGALRM);
+}
+
+static void set_tick_timer(long usec) {
+  struct itimerval timer;
+  timer.it_interval.tv_sec = 0;
+  timer.it_interval.tv_usec = TICK_USEC;
+  timer.it_value.tv_sec = usec / 1000000L;
+  timer.it_value.tv_usec = usec % 1000000L;
+  setitimer(ITIMER_REAL, &timer, NULL);
+}
+
+/**
+ * @brief Stretch the current tick period to the next timer expiry.
+ * The tick signal should be blocked.
+ */
+static void tickless_enter() {
+  struct itimerval timer;
+  uint32_t ticks = ros_timer_next_expiry();
+  if (ticks <= 1 || tick_pending()) return;
+  // the ticks fit in a long of usec for years
+  if (ticks > 100000UL) ticks = 100000UL;
+  getitimer(ITIMER_REAL, &timer);
+  // the current tick period is partly elapsed
+  set_tick_timer(timer.it_value.tv_usec + (ticks - 1) * TICK_USEC);
+  tickless_ticks = ticks;
+}
+
+/**
+ * @brief Woken up before the stretched period ends: announce the elapsed
+ * ticks, and end the period at the next tick boundary.
+ * The tick signal should be blocked.
+ */
+void ros_tickless_exit() {
+  struct itimerval timer;
+  if (tickless_ticks == 0 || tick_pending()) return;
+  getitimer(ITIMER_REAL, &timer);
+  long remaining = timer.it_value.tv_sec * 1000000L + timer.it_value.tv_usec;
+  // whole ticks still to go, not including the current one
+  uint32_t remaining_ticks = (remaining - 1) / TICK_USEC;
+  if (remaining_ticks == 0) return;
+  set_tick_timer(remaining - remaining_ticks * TICK_USEC);
+  uint32_t elapsed = tickless_ticks - 1 - remaining_ticks;
+  tickless_ticks = 1;
+  ros_sys_tick_advance(elapsed);
+}
+#endif
+
+/**
+ * @brief The idle task just waits for the next signal
+ */
+void ros_idle_task() {
+  while (1) {
+#if ROS_TICKLESS
+    sigset_t wait_set;
+    uint8_t sreg = ros_port_irq_save();
+    tickless_enter();
+    // unblock the tick signal and wait for it atomically, like sei; sleep
+    sigprocmask(SIG_SETMASK, NULL, &wait_set);
+    sigdelset(&wait_set, SIGALRM);
+    sigsuspend(&wait_set);
+    ros_tickless_exit();
+    ros_port_irq_restore(sreg);
+#else
+    pause();
+#endif
+  }
+}
+
+/**
+ * @brief Wrapper of task function, terminated it and re-schedule when a task
+ * run to compeletion
+ */
+static void task_shell() {
+  ROS_TCB *cur_tcb = ros_current_tcb();
+
+  // enable interrupt after context switching finished.
+  ros_port_irq_restore(1);
+
+  if (cur_tcb && cur_tcb->task_entry) {
+    cur_tcb->task_entry();
+    // when the task terminated(task return), remove it from ready list and
+    cur_tcb->status = TASK_TERMINATED;
+  }
+  // re-schedule
+  ros_schedule();
+}
+
+#if defined(__x86_64__)
+
+/**
+ * Context frame on x86_64, from low address to high:
+ * r15, r14, r13, r12, rbx, rbp, return address
+ * The return address is placed so that task_shell() starts with the stack
+ * aligned as if it was called.
+ */
+void ros_task_context_init(ROS_TCB *tcb_ptr, task_func task_f, void *sp) {
+  uintptr_t top = ((uintptr_t)sp + 1) & ~(uintptr_t)15;
+  uintptr_t *frame = (uintptr_t *)(top - 16);
+  (void)task_f;
+  frame[0] = (uintptr_t)task_shell;
+  frame[1] = 0;  // task_shell never returns
+  frame -= 6;
+  memset(frame, 0, 6 * sizeof(uintptr_t));  // rbp, rbx, r12-r15
+  tcb_ptr->sp = frame;
+}
+
+/**
+ * Specific context switch routine for x86_64, the same 4 steps as the avr one:
+ * push the callee-saved registers, save rsp to old_tcb->sp(if old_tcb is not
+ * NULL), load rsp from new_tcb->sp, pop the callee-saved registers.
+ * old_tcb in rdi, new_tcb in rsi.
+ */
+__asm__(
+    ".text\n"
+    ".globl ros_switch_context\n"
+    ".type ros_switch_context, @function\n"
+    "ros_switch_context:\n\t"
+    "pushq %rbp\n\t"
+    "pushq %rbx\n\t"
+    "pushq %r12\n\t"
+    "pushq %r13\n\t"
+    "pushq %r14\n\t"
+    "pushq %r15\n\t"
+    "testq %rdi, %rdi\n\t"
+    "jz 1f\n\t"
+    "movq %rsp, (%rdi)\n"
+    "1:\n\t"
+    "movq (%rsi), %rsp\n\t"
+    "popq %r15\n\t"
+    "popq %r14\n\t"
+    "popq %r13\n\t"
+    "popq %r12\n\t"
+    "popq %rbx\n\t"
+    "popq %rbp\n\t"
+    "ret\n\t"
+    ".size ros_switch_context, .-ros_switch_context\n");
+
+#elif defined(__aarch64__)
+
+/**
+ * Context frame on aarch64, 160 bytes from low address to high:
+ * x19-x28, x29(fp), x30(lr), d8-d15
+ * The lr slot holds task_shell for a new task.
+ */
+void ros_task_context_init(ROS_TCB *tcb_ptr, task_func task_f, void *sp) {
+  uintptr_t top = ((uintptr_t)sp + 1) & ~(uintptr_t)15;
+  uintptr_t *frame = (uintptr_t *)(top - 160);
+  (void)task_f;
+  memset(frame, 0, 160);
+  frame[11] = (uintptr_t)task_shell;  // x30
+  tcb_ptr->sp = frame;
+}
+
+// old_tcb in x0, new_tcb in x1
+__asm__(
+    ".text\n"
+    ".globl ros_switch_context\n"
+    ".type ros_switch_context, %function\n"
+    "ros_switch_context:\n\t"
+    "sub sp, sp, #160\n\t"
+    "stp x19, x20, [sp, #0]\n\t"
+    "stp x21, x22, [sp, #16]\n\t"
+    "stp x23, x24, [sp, #32]\n\t"
+    "stp x25, x26, [sp, #48]\n\t"
+    "stp x27, x28, [sp, #64]\n\t"
+    "stp x29, x30, [sp, #80]\n\t"
+    "stp d8, d9, [sp, #96]\n\t"
+    "stp d10, d11, [sp, #112]\n\t"
+    "stp d12, d13, [sp, #128]\n\t"
+    "stp d14, d15, [sp, #144]\n\t"
+    "cbz x0, 1f\n\t"
+    "mov x9, sp\n\t"
+    "str x9, [x0]\n"
+    "1:\n\t"
+    "ldr x9, [x1]\n\t"
+    "mov sp, x9\n\t"
+    "ldp x19, x20, [sp, #0]\n\t"
+    "ldp x21, x22, [sp, #16]\n\t"
+    "ldp x23, x24, [sp, #32]\n\t"
+    "ldp x25, x26, [sp, #48]\n\t"
+    "ldp x27, x28, [sp, #64]\n\t"
+    "ldp x29, x30, [sp, #80]\n\t"
+    "ldp d8, d9, [sp, #96]\n\t"
+    "ldp d10, d11, [sp, #112]\n\t"
+    "ldp d12, d13, [sp, #128]\n\t"
+    "ldp d14, d15, [sp, #144]\n\t"
+    "add sp, sp, #160\n\t"
+    "ret\n\t"
+    ".size ros_switch_context, .-ros_switch_context\n");
+
+#else
+#error "ros_port_linux.c: unsupported host architecture"
+#endif
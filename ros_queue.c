@@ -0,0 +1,161 @@
+#include "ros_queue.h"
+#include <string.h>
+
+static inline uint8_t next_slot(ROS_QUEUE *queue, uint8_t slot) {
+  return ++slot == queue->slots ? 0 : slot;
+}
+
+// copy item to tail slot, then publish it by moving tail
+static bool queue_put(ROS_QUEUE *queue, const void *item) {
+  uint8_t tail = queue->tail;
+  uint8_t next = next_slot(queue, tail);
+  if (next == queue->head) return false;
+  memcpy(queue->buffer + tail * queue->item_size, item, queue->item_size);
+  ROS_BARRIER();
+  queue->tail = next;
+  return true;
+}
+
+// copy item from head slot, then free it by moving head
+static bool queue_get(ROS_QUEUE *queue, void *item) {
+  uint8_t head = queue->head;
+  if (head == queue->tail) return false;
+  memcpy(item, queue->buffer + head * queue->item_size, queue->item_size);
+  ROS_BARRIER();
+  queue->head = next_slot(queue, head);
+  return true;
+}
+
+// ticks left to wait since start, 0 if timeout
+static uint32_t remaining_ticks(uint32_t timeout, uint32_t start) {
+  if (timeout == ROS_WAIT_FOREVER) return timeout;
+  uint32_t elapsed = ros_get_sys_tick() - start;
+  return elapsed >= timeout ? 0 : timeout - elapsed;
+}
+
+// wake up a task waiting on the other side, interrupt should be disabled
+static void wake_waiting(ROS_TCB **wait_list) {
+  // no schedule in ISR, until ros_int_exit()
+  if (ros_wake_first(wait_list, ROS_OK)) ros_schedule();
+}
+
+/**
+ * @brief init a message queue
+ * @param  *queue: the caller provides the queue storage
+ * @param  *buffer: the caller provides ROS_QUEUE_BUFFER_SIZE(item_size,
+ * capacity) bytes
+ * @param  item_size: bytes of a message
+ * @param  capacity: max messages in the queue, 1~ROS_QUEUE_MAX_CAPACITY
+ * @param  flags: ROS_QUEUE_SPSC or 0
+ * @retval ROS_OK Success
+ * @retval ROS_ERR_PARAM Bad param
+ */
+status_t ros_queue_init(ROS_QUEUE *queue, void *buffer, uint8_t item_size,
+                        uint8_t capacity, uint8_t flags) {
+  if (queue == NULL || buffer == NULL || item_size == 0 || capacity == 0 ||
+      capacity > ROS_QUEUE_MAX_CAPACITY) {
+    return ROS_ERR_PARAM;
+  }
+  queue->buffer = buffer;
+  queue->item_size = item_size;
+  queue->slots = capacity + 1;
+  queue->flags = flags;
+  queue->head = 0;
+  queue->tail = 0;
+  queue->send_wait = NULL;
+  queue->recv_wait = NULL;
+  return ROS_OK;
+}
+
+/**
+ * @brief copy a message to the queue, block current task while it's full
+ * @param  timeout: ticks to wait, ROS_NO_WAIT(the only choice in ISR) or
+ * ROS_WAIT_FOREVER
+ * @retval ROS_OK Success
+ * @retval ROS_ERR_TIMEOUT the queue is still full after timeout ticks
+ * @retval ROS_ERR_CONTEXT blocking in ISR
+ */
+status_t ros_queue_send(ROS_QUEUE *queue, const void *item, uint32_t timeout) {
+  status_t status = ROS_OK;
+  if (queue == NULL || item == NULL) return ROS_ERR_PARAM;
+  uint32_t start = ros_get_sys_tick();
+  CRITICAL_STORE;
+  CRITICAL_START();
+  while (!queue_put(queue, item)) {
+    uint32_t ticks = remaining_ticks(timeout, start);
+    status = ticks ? ros_wait(&queue->send_wait, ticks) : ROS_ERR_TIMEOUT;
+    // woken up, but another sender may fill the space first, try again
+    if (status != ROS_OK) break;
+  }
+  if (status == ROS_OK) wake_waiting(&queue->recv_wait);
+  CRITICAL_END();
+  return status;
+}
+
+/**
+ * @brief copy a message out of the queue, block current task while it's empty.
+ * For ROS_QUEUE_SPSC, interrupt is only disabled to block or wake up a task.
+ * @param  timeout: ticks to wait, ROS_NO_WAIT(the only choice in ISR) or
+ * ROS_WAIT_FOREVER
+ * @retval ROS_OK Success
+ * @retval ROS_ERR_TIMEOUT the queue is still empty after timeout ticks
+ * @retval ROS_ERR_CONTEXT blocking in ISR
+ */
+status_t ros_queue_recv(ROS_QUEUE *queue, void *item, uint32_t timeout) {
+  status_t status = ROS_OK;
+  if (queue == NULL || item == NULL) return ROS_ERR_PARAM;
+  CRITICAL_STORE;
+  if ((queue->flags & ROS_QUEUE_SPSC) && queue_get(queue, item)) {
+    if (queue->send_wait) {
+      CRITICAL_START();
+      wake_waiting(&queue->send_wait);
+      CRITICAL_END();
+    }
+    return ROS_OK;
+  }
+  uint32_t start = ros_get_sys_tick();
+  CRITICAL_START();
+  while (!queue_get(queue, item)) {
+    uint32_t ticks = remaining_ticks(timeout, start);
+    status = ticks ? ros_wait(&queue->recv_wait, ticks) : ROS_ERR_TIMEOUT;
+    if (status != ROS_OK) break;
+  }
+  if (status == ROS_OK) wake_waiting(&queue->send_wait);
+  CRITICAL_END();
+  return status;
+}
+
+/**
+ * @brief the lock-free sender of ROS_QUEUE_SPSC, call it from the only one ISR
+ * sending to the queue. The receiving task is scheduled at ros_int_exit()
+ * @retval ROS_OK Success
+ * @retval ROS_ERR_FULL the queue is full
+ */
+status_t ros_queue_send_isr(ROS_QUEUE *queue, const void *item) {
+  if (queue == NULL || item == NULL) return ROS_ERR_PARAM;
+  if (!queue_put(queue, item)) return ROS_ERR_FULL;
+  if (queue->recv_wait) {
+    // interrupt is already disabled in ISR, this costs nothing
+    CRITICAL_STORE;
+    CRITICAL_START();
+    wake_waiting(&queue->recv_wait);
+    CRITICAL_END();
+  }
+  return ROS_OK;
+}
+
+// messages in the queue
+uint8_t ros_queue_count(ROS_QUEUE *queue) {
+  uint8_t head = queue->head, tail = queue->tail;
+  return tail >= head ? tail - head : tail + queue->slots - head;
+}
+
+status_t ros_queue_send_ptr(ROS_QUEUE *queue, void *ptr, uint32_t timeout) {
+  if (queue == NULL || queue->item_size != sizeof(void *)) return ROS_ERR_PARAM;
+  return ros_queue_send(queue, &ptr, timeout);
+}
+
+status_t ros_queue_recv_ptr(ROS_QUEUE *queue, void **ptr, uint32_t timeout) {
+  if (queue == NULL || queue->item_size != sizeof(void *)) return ROS_ERR_PARAM;
+  return ros_queue_recv(queue, ptr, timeout);
+}
@@ -0,0 +1,58 @@
+#ifndef __ROS_QUEUE_H__
+#define __ROS_QUEUE_H__
+
+#include "ros.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Fixed-size message queue, a ring buffer of items copied in and out. The
+ * caller provides the buffer storage of ROS_QUEUE_BUFFER_SIZE bytes, one slot
+ * more than the capacity to tell full from empty without a shared count.
+ *
+ * head is only changed by the receiver and tail only by the sender, so with
+ * ROS_QUEUE_SPSC(one sender, usually an ISR, and one receiving task)
+ * ros_queue_send_isr() and the ros_queue_recv() fast path never disable
+ * interrupt.
+ */
+typedef struct ros_queue {
+  uint8_t *buffer;
+  uint8_t item_size;
+  // capacity + 1
+  uint8_t slots;
+  uint8_t flags;
+  // next slot to receive
+  volatile uint8_t head;
+  // next slot to send
+  volatile uint8_t tail;
+  // tasks waiting for space and for items, ordered by priority
+  ROS_TCB *send_wait;
+  ROS_TCB *recv_wait;
+} ROS_QUEUE;
+
+#define ROS_QUEUE_BUFFER_SIZE(item_size, capacity) \
+  ((item_size) * ((capacity) + 1))
+#define ROS_QUEUE_MAX_CAPACITY 254
+
+// flags
+#define ROS_QUEUE_SPSC 0x01
+
+status_t ros_queue_init(ROS_QUEUE *queue, void *buffer, uint8_t item_size,
+                        uint8_t capacity, uint8_t flags);
+status_t ros_queue_send(ROS_QUEUE *queue, const void *item, uint32_t timeout);
+status_t ros_queue_recv(ROS_QUEUE *queue, void *item, uint32_t timeout);
+// lock-free single sender for ROS_QUEUE_SPSC, never blocks
+status_t ros_queue_send_isr(ROS_QUEUE *queue, const void *item);
+uint8_t ros_queue_count(ROS_QUEUE *queue);
+
+// pointer-sized messages, hand over a buffer without copying it
+status_t ros_queue_send_ptr(ROS_QUEUE *queue, void *ptr, uint32_t timeout);
+status_t ros_queue_recv_ptr(ROS_QUEUE *queue, void **ptr, uint32_t timeout);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  //__ROS_QUEUE_H__
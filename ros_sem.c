@@ -0,0 +1,65 @@
+#include "ros_sem.h"
+
+/**
+ * @brief init a semaphore
+ * @param  *sem: the caller provides the semaphore storage
+ * @param  count: initial count
+ * @retval ROS_OK Success
+ * @retval ROS_ERR_PARAM Bad param
+ */
+status_t ros_sem_init(ROS_SEM *sem, uint16_t count) {
+  if (sem == NULL) return ROS_ERR_PARAM;
+  sem->count = count;
+  sem->wait_list = NULL;
+  return ROS_OK;
+}
+
+/**
+ * @brief take the semaphore, block current task until it's given or timeout
+ * @param  timeout: ticks to wait, ROS_NO_WAIT(the only choice in ISR) or
+ * ROS_WAIT_FOREVER
+ * @retval ROS_OK Success
+ * @retval ROS_ERR_TIMEOUT the semaphore is not given in timeout ticks
+ * @retval ROS_ERR_CONTEXT blocking in ISR
+ */
+status_t ros_sem_take(ROS_SEM *sem, uint32_t timeout) {
+  status_t status;
+  if (sem == NULL) return ROS_ERR_PARAM;
+  CRITICAL_STORE;
+  CRITICAL_START();
+  if (sem->count > 0) {
+    sem->count--;
+    status = ROS_OK;
+  } else if (timeout == ROS_NO_WAIT) {
+    status = ROS_ERR_TIMEOUT;
+  } else {
+    // the giver hands the semaphore to us directly, the count is untouched
+    status = ros_wait(&sem->wait_list, timeout);
+  }
+  CRITICAL_END();
+  return status;
+}
+
+/**
+ * @brief give the semaphore to the highest priority waiting task, or increase
+ * the count if no one is waiting. In ISR the woken up task will be scheduled at
+ * ros_int_exit()
+ * @retval ROS_OK Success
+ * @retval ROS_ERROR count overflow
+ */
+status_t ros_sem_give(ROS_SEM *sem) {
+  status_t status = ROS_OK;
+  if (sem == NULL) return ROS_ERR_PARAM;
+  CRITICAL_STORE;
+  CRITICAL_START();
+  if (ros_wake_first(&sem->wait_list, ROS_OK)) {
+    // no schedule in ISR, until ros_int_exit()
+    ros_schedule();
+  } else if (sem->count == UINT16_MAX) {
+    status = ROS_ERROR;
+  } else {
+    sem->count++;
+  }
+  CRITICAL_END();
+  return status;
+}
@@ -0,0 +1,29 @@
+#ifndef __ROS_SEM_H__
+#define __ROS_SEM_H__
+
+#include "ros.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Counting semaphore, the waiting tasks are woken up highest priority first.
+ * A binary semaphore is just a semaphore initialized with count 0 or 1.
+ */
+typedef struct ros_sem {
+  uint16_t count;
+  // tasks waiting for the semaphore, ordered by priority
+  ROS_TCB *wait_list;
+} ROS_SEM;
+
+status_t ros_sem_init(ROS_SEM *sem, uint16_t count);
+status_t ros_sem_take(ROS_SEM *sem, uint32_t timeout);
+// safe to call from ISR
+status_t ros_sem_give(ROS_SEM *sem);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  //__ROS_SEM_H__
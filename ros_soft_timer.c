@@ -0,0 +1,131 @@
+#include "ros_soft_timer.h"
+
+#if ROS_SOFT_TIMERS
+
+#if !ROS_WORK_QUEUE
+#error "ROS_SOFT_TIMERS needs ROS_WORK_QUEUE to run the callbacks"
+#endif
+
+/**
+ * @brief The timer expired, queue its callback. In the tick ISR, interrupt
+ * disabled.
+ * @param  *timer: the timer member of a ROS_SOFT_TIMER
+ * @param  due: the sys tick it expired at
+ */
+void ros_soft_timer_expire(ROS_TIMER *timer, uint32_t due) {
+  ROS_SOFT_TIMER *soft_timer = (ROS_SOFT_TIMER *)timer;
+  soft_timer->due = due;
+  soft_timer->expired = true;
+  ros_work_submit(&soft_timer->work);
+}
+
+/**
+ * @brief Run by the work queue task: reload an auto-reload timer from the tick
+ * it was due, so the period never drifts, then call the callback.
+ */
+static void soft_timer_work(void *arg) {
+  ROS_SOFT_TIMER *timer = (ROS_SOFT_TIMER *)arg;
+  // the tick ISR never touches a timer out of the queue, only the other tasks
+  // may restart or stop it
+  ros_sched_lock();
+  // stopped or restarted after it expired
+  if (!timer->expired) {
+    ros_sched_unlock();
+    return;
+  }
+  timer->expired = false;
+  if (timer->period) {
+    uint32_t late = ros_get_sys_tick() - timer->due;
+    // too late to catch up, expire at the next tick
+    timer->timer.ticks = late < timer->period ? timer->period - late : 1;
+    ros_register_timer(&timer->timer);
+  } else {
+    timer->active = false;
+  }
+  ros_sched_unlock();
+  timer->func(timer->arg);
+}
+
+// cancel the timer in the queue or the expiry not run, interrupt disabled
+static void soft_timer_cancel(ROS_SOFT_TIMER *timer) {
+  if (timer->active && !timer->expired) ros_unregister_timer(&timer->timer);
+  timer->expired = false;
+  timer->active = false;
+}
+
+/**
+ * @brief init a stopped timer
+ * @param  *timer: the caller provides the timer storage
+ * @param  func: called by the work queue task when the timer expires
+ * @param  *arg: passed to func
+ * @retval ROS_OK Success
+ * @retval ROS_ERR_PARAM Bad param
+ */
+status_t ros_soft_timer_init(ROS_SOFT_TIMER *timer, soft_timer_func func,
+                             void *arg) {
+  if (timer == NULL || func == NULL) return ROS_ERR_PARAM;
+  timer->timer.blocked_tcb = NULL;
+  timer->timer.ticks = 0;
+  timer->timer.next_timer = NULL;
+  timer->timer.prev_timer = NULL;
+  ros_work_init(&timer->work, soft_timer_work, timer);
+  timer->func = func;
+  timer->arg = arg;
+  timer->period = 0;
+  timer->due = 0;
+  timer->active = false;
+  timer->expired = false;
+  return ROS_OK;
+}
+
+/**
+ * @brief (Re)start the timer, it expires after ticks, then every period ticks.
+ * Call it from a task, the timer queue is walked with interrupt enabled.
+ * @param  ticks: ticks to the first expiry, at least 1
+ * @param  period: reload ticks, 0 for a one-shot timer
+ * @retval ROS_OK Success
+ * @retval ROS_ERR_PARAM Bad param
+ */
+status_t ros_soft_timer_start(ROS_SOFT_TIMER *timer, uint32_t ticks,
+                              uint32_t period) {
+  if (timer == NULL || ticks == 0) return ROS_ERR_PARAM;
+  CRITICAL_STORE;
+  ros_sched_lock();
+  // it may be expiring in the tick ISR
+  CRITICAL_START();
+  soft_timer_cancel(timer);
+  CRITICAL_END();
+  timer->period = period;
+  timer->timer.ticks = ticks;
+  timer->active = true;
+  ros_register_timer(&timer->timer);
+  ros_sched_unlock();
+  return ROS_OK;
+}
+
+/**
+ * @brief Stop the timer, its callback is not called any more, unless it's
+ * running already. Call it from a task.
+ */
+status_t ros_soft_timer_stop(ROS_SOFT_TIMER *timer) {
+  if (timer == NULL) return ROS_ERR_PARAM;
+  CRITICAL_STORE;
+  CRITICAL_START();
+  soft_timer_cancel(timer);
+  CRITICAL_END();
+  return ROS_OK;
+}
+
+/**
+ * @brief Restart an auto-reload timer with a new period from now
+ */
+status_t ros_soft_timer_change_period(ROS_SOFT_TIMER *timer, uint32_t period) {
+  if (period == 0) return ROS_ERR_PARAM;
+  return ros_soft_timer_start(timer, period, period);
+}
+
+bool ros_soft_timer_active(ROS_SOFT_TIMER *timer) {
+  return timer && timer->active;
+}
+
+#endif  // ROS_SOFT_TIMERS
@@ -0,0 +1,51 @@
+#ifndef __ROS_SOFT_TIMER_H__
+#define __ROS_SOFT_TIMER_H__
+
+#include "ros.h"
+#include "ros_work.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*soft_timer_func)(void *arg);
+
+/**
+ * Software timer, calls func(arg) when it expires, one-shot or auto-reload.
+ * It shares the timer queue with ros_delay(), and the work queue task runs
+ * the callbacks, so many timers cost no stack but the work queue task's.
+ * A callback should not block for long, it delays the other timers.
+ */
+typedef struct ros_soft_timer {
+  // in the timer queue, with no blocked_tcb
+  ROS_TIMER timer;
+  // submitted to the work queue when the timer expires
+  ROS_WORK work;
+  soft_timer_func func;
+  void *arg;
+  // reload ticks, 0 for one-shot
+  uint32_t period;
+  // the sys tick the timer is due, the next period starts from it
+  uint32_t due;
+  // started and not stopped, or a one-shot not run yet
+  volatile bool active;
+  // expired, the callback is not run yet
+  volatile bool expired;
+} ROS_SOFT_TIMER;
+
+status_t ros_soft_timer_init(ROS_SOFT_TIMER *timer, soft_timer_func func,
+                             void *arg);
+status_t ros_soft_timer_start(ROS_SOFT_TIMER *timer, uint32_t ticks,
+                              uint32_t period);
+status_t ros_soft_timer_stop(ROS_SOFT_TIMER *timer);
+status_t ros_soft_timer_change_period(ROS_SOFT_TIMER *timer, uint32_t period);
+bool ros_soft_timer_active(ROS_SOFT_TIMER *timer);
+
+// define in ros_soft_timer.c, called by the timer queue in the tick ISR
+void ros_soft_timer_expire(ROS_TIMER *timer, uint32_t due);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  //__ROS_SOFT_TIMER_H__
@@ -1,136 +1,418 @@
 #include "ros_timer.h"
 #include "ros.h"
-#include <stdio.h>
+#if ROS_SOFT_TIMERS
+#include "ros_soft_timer.h"
+#endif
 
 static ROS_TIMER *timer_queue;
+// changed by every insert and remove of the timer queue, so a walk with
+// interrupt enabled finds out it's stale: a timer left behind in the walk may
+// be gone from the stack of another task. 32 bits never come back to the same
+// value while a walker is preempted. Decrementing the head every tick doesn't
+// change it, the timers after the head keep their expiry time.
+static volatile uint32_t timer_queue_version = 0;
 static uint32_t ros_sys_ticks = 0;
-static char day_time[9];  // format: 00:00:00
+// ticks announced to the timer queue, ros_set_sys_tick() doesn't change it
+static uint32_t timer_ticks = 0;
+// times ros_sys_ticks has wrapped around, the high half of the 64 bits tick
+static uint32_t ros_sys_ticks_hi = 0;
+#if ROS_TIME_OF_DAY
+// carried at every tick, so reading the time of day takes no division
+static ROS_DAY_TIME day_time;
+static char day_time_str[9];  // format: 00:00:00
+#endif
 
+// the timer is already removed from the queue, ros_wake() should not cancel it
 static void wakeup_task(ROS_TCB *tcb) {
   CRITICAL_STORE;
   CRITICAL_START();
-  tcb->status = TASK_READY;
-  ros_tcb_enqueue(tcb);
+  tcb->timer = NULL;
+  ros_wake(tcb, ROS_ERR_TIMEOUT);
   CRITICAL_END();
 }
 
-// dec the ticks of every timer in timer_queue, wake up task if ticks == 0
-void ros_check_timer() {
+/**
+ * The timer queue is a delta list ordered by expiry time, the ticks of a timer
+ * in the queue is relative to the previous one, so the head is the first to
+ * expire and only the head is decremented every tick. The timers expire at the
+ * same tick are the head and the following ones with 0 ticks.
+ * @param  ticks: ticks elapsed since last check
+ */
+static void check_timer(uint32_t ticks) {
+  timer_ticks += ticks;
+  // remove expired timers from the queue head, and wake up their tasks
+  while (timer_queue) {
+    if (timer_queue->ticks > ticks) {
+      timer_queue->ticks -= ticks;
+      break;
+    }
+    // the rest of elapsed ticks is relative to the next timer
+    ticks -= timer_queue->ticks;
+    ROS_TIMER *expired = timer_queue;
+    timer_queue_version++;
+    timer_queue = expired->next_timer;
+    if (timer_queue) timer_queue->prev_timer = NULL;
+    // make this timer isolate
+    expired->next_timer = NULL;
+#if ROS_SOFT_TIMERS
+    // a software timer has no task to wake up, it expired ticks ago
+    if (expired->blocked_tcb == NULL) {
+      ros_soft_timer_expire(expired, ros_sys_ticks - ticks);
+      continue;
+    }
+#endif
+    wakeup_task(expired->blocked_tcb);
+  }
+}
+
+void ros_check_timer() { check_timer(1); }
+
+/**
+ * @retval ticks until the timer queue head expires, at least 1, or UINT32_MAX
+ * if there is no timer
+ */
+uint32_t ros_timer_next_expiry() {
+  if (timer_queue == NULL) return UINT32_MAX;
+  return timer_queue->ticks ? timer_queue->ticks : 1;
+}
+
+/**
+ * Insert timer to the delta list, after the timers expire at the same tick.
+ * Walking the queue takes O(N), but it's in task context instead of the tick
+ * ISR. If it's called with interrupt enabled, interrupts are let in between
+ * two steps of the walk, and it starts over if a timer was inserted or
+ * removed meanwhile, so interrupt is only disabled for O(1) time at once.
+ * timer->ticks count from timer_ticks start, however long the walk takes.
+ */
+static void timer_insert(ROS_TIMER *timer, uint32_t start) {
+  CRITICAL_STORE;
   ROS_TIMER *prev, *next;
-  prev = next = timer_queue;
-  // timer list to wakeup
-  ROS_TIMER *wakeup_head = NULL, *cur_wakeup = NULL;
-  // Remove timer which's ticks = 0 from timer queue, and add to wakeup list
-  while (next) {
-    // use to update next
-    ROS_TIMER *saved_next = next->next_timer;
-    if ((--next->ticks) == 0) {
-      if (next == timer_queue) {
-        timer_queue = next->next_timer;
-      } else {
-        // remove a mid or tail timer
-        prev->next_timer = next->next_timer;
-      }
-      // make this timer isolate
-      next->next_timer = NULL;
-      if (wakeup_head == NULL) {
-        cur_wakeup = wakeup_head = next;
-      } else {
-        cur_wakeup->next_timer = next;
-        cur_wakeup = cur_wakeup->next_timer;
-      }
-    } else {
-      // Use previous timer to remove timer
+  uint32_t ticks;
+  uint32_t version;
+  CRITICAL_START();
+  do {
+    version = timer_queue_version;
+    prev = NULL;
+    next = timer_queue;
+    // the head ticks count from now, due at the next tick if it's passed
+    ticks = timer_ticks - start;
+    ticks = timer->ticks > ticks ? timer->ticks - ticks : 0;
+    while (next && next->ticks <= ticks) {
+      ticks -= next->ticks;
       prev = next;
+      next = next->next_timer;
+      // a no-op if interrupt was disabled by the caller
+      CRITICAL_END();
+      CRITICAL_START();
+      if (version != timer_queue_version) break;
     }
-    next = saved_next;
+  } while (version != timer_queue_version);
+  timer_queue_version++;
+  timer->ticks = ticks;
+  timer->prev_timer = prev;
+  timer->next_timer = next;
+  if (next) {
+    // the next timer is relative to the inserted one now
+    next->ticks -= ticks;
+    next->prev_timer = timer;
   }
-
-  // walk through wakeup list
-  while (wakeup_head) {
-    wakeup_task(wakeup_head->blocked_tcb);
-    wakeup_head = wakeup_head->next_timer;
+  if (prev) {
+    prev->next_timer = timer;
+  } else {
+    timer_queue = timer;
   }
+  CRITICAL_END();
+}
+
+// timer_ticks read at once, 4 bytes on avr
+static uint32_t timer_now() {
+  CRITICAL_STORE;
+  uint32_t ticks;
+  CRITICAL_START();
+  ticks = timer_ticks;
+  CRITICAL_END();
+  return ticks;
+}
+
+/**
+ * Sleep current task until ticks after timer_ticks start. The timer is
+ * registered before the task blocks, so unlike ros_wait() the walk of the
+ * timer queue lets interrupts in. Call it with interrupt enabled.
+ */
+static status_t timer_sleep(ROS_TCB *tcb, uint32_t start, uint32_t ticks) {
+  ROS_TIMER timer;
+  status_t status;
+  CRITICAL_STORE;
+  // the timer lives on the stack of the sleeping task
+  timer.ticks = ticks;
+  timer.blocked_tcb = tcb;
+  CRITICAL_START();
+  tcb->timer = &timer;
+  CRITICAL_END();
+  timer_insert(&timer, start);
+  // keep interrupt disabled until swapped out, or the timer may expire
+  // before the task is blocked
+  CRITICAL_START();
+  ROS_TRACE_EVENT(ROS_TRACE_DELAY, ticks > 0xFF ? 0xFF : ticks);
+  status = ros_wait_timer(&timer);
+  CRITICAL_END();
+  return status;
 }
 
 // delay current tcb
 status_t ros_delay(uint32_t ticks) {
-  ROS_TIMER timer;
   ROS_TCB *cur_tcb;
   uint8_t status;
-  CRITICAL_STORE;
   cur_tcb = ros_current_tcb();
   if (ticks == 0) {
     status = ROS_ERR_PARAM;
-  } else if (cur_tcb == NULL) {
+  } else if (cur_tcb == NULL || ros_sched_locked()) {
+    // it can't sleep with the scheduler locked
     status = ROS_ERR_CONTEXT;
   } else {
-    CRITICAL_START();
-    cur_tcb->status = TASK_BLOCKED;
-    timer.ticks = ticks;
-    timer.blocked_tcb = cur_tcb;
-    if (ros_register_timer(&timer) != ROS_OK) {
-      status = ROS_ERR_TIMER;
-      CRITICAL_END();
-    } else {
-      status = ROS_OK;
-      CRITICAL_END();
-      // call scheduler to swap out current task
-      ros_schedule();
-    }
+    // swap out current task, until the timer expires
+    status = timer_sleep(cur_tcb, timer_now(), ticks);
+    if (status != ROS_ERR_CONTEXT) status = ROS_OK;
   }
   return status;
 }
 
-// insert timer to the timer queue head
-status_t ros_register_timer(ROS_TIMER *timer) {
-  if (timer == NULL || timer->blocked_tcb == NULL) {
-    return ROS_ERR_PARAM;
-  }
+/**
+ * @brief Delay current tcb until period ticks after *last_wake, for a fixed
+ * rate loop that doesn't drift with the work time:
+ *   uint32_t last_wake = ros_get_sys_tick();
+ *   while (1) { sample(); ros_delay_until(&last_wake, 10); }
+ * If the wake time has passed, the missed periods are skipped, counted in the
+ * task's deadline_misses, and it wakes at the next one in phase, right away if
+ * that one is now. With ROS_SCHED_EDF and a relative deadline, the late job is
+ * counted instead, when it blocks.
+ * The sys tick may wrap around, only the difference of ticks is compared.
+ * @param  *last_wake: the last wake time, updated to the new one
+ * @param  period: ticks between two wake times
+ * @retval ROS_OK Success
+ * @retval ROS_ERR_DEADLINE missed at least one wake time
+ * @retval ROS_ERR_CONTEXT not in a task, or the scheduler is locked, neither
+ * *last_wake nor the misses are changed
+ */
+status_t ros_delay_until(uint32_t *last_wake, uint32_t period) {
+  ROS_TCB *cur_tcb = ros_current_tcb();
+  status_t status = ROS_OK;
   CRITICAL_STORE;
+  if (last_wake == NULL || period == 0) return ROS_ERR_PARAM;
+  if (cur_tcb == NULL) return ROS_ERR_CONTEXT;
   CRITICAL_START();
-  if (timer_queue == NULL) {
-    timer_queue = timer;
-    timer_queue->next_timer = NULL;
-  } else {
-    timer->next_timer = timer_queue;
-    timer_queue = timer;
+  uint32_t now = ros_sys_ticks;
+  uint32_t start = timer_ticks;
+  uint32_t wake = *last_wake + period;
+  uint32_t missed = 0;
+  if (ros_time_before(wake, now)) {
+    // skip to the first wake time not before now, it may be now
+    missed = (now - wake - 1) / period + 1;
+    wake += missed * period;
+    status = ROS_ERR_DEADLINE;
   }
+  // it can't sleep with the scheduler locked, nothing is updated
+  if (wake != now && ros_sched_locked()) {
+    CRITICAL_END();
+    return ROS_ERR_CONTEXT;
+  }
+#if ROS_SCHED_EDF
+  // an EDF job is counted once when it blocks, if it's done after its deadline
+  if (cur_tcb->relative_deadline) missed = 0;
+#endif
+  if (missed) {
+    missed += cur_tcb->deadline_misses;
+    cur_tcb->deadline_misses = missed > UINT16_MAX ? UINT16_MAX : missed;
+  }
+  *last_wake = wake;
   CRITICAL_END();
+  // due right now
+  if (wake != now) timer_sleep(cur_tcb, start, wake - now);
+  return status;
+}
+
+/**
+ * @brief insert timer to the timer queue, see timer_insert(). ros_wait() calls
+ * it with interrupt disabled, the other callers should let interrupts in.
+ * @param  *timer: timer->ticks is the ticks to delay, it will be changed to
+ * the ticks relative to the previous timer in the queue
+ */
+status_t ros_register_timer(ROS_TIMER *timer) {
+  if (timer == NULL) return ROS_ERR_PARAM;
+#if !ROS_SOFT_TIMERS
+  // only a software timer has no task
+  if (timer->blocked_tcb == NULL) return ROS_ERR_PARAM;
+#endif
+  timer_insert(timer, timer_now());
   return ROS_OK;
 }
 
+/**
+ * @brief remove a timer from the timer queue before it expires, the following
+ * timer takes over its ticks. It takes O(1) time with the doubly links.
+ * @retval ROS_ERR_PARAM the timer is not in the queue
+ */
+status_t ros_unregister_timer(ROS_TIMER *timer) {
+  status_t status = ROS_ERR_PARAM;
+  CRITICAL_STORE;
+  CRITICAL_START();
+  // only the head has no previous timer in the queue
+  if (timer->prev_timer || timer_queue == timer) {
+    ROS_TIMER *next = timer->next_timer;
+    timer_queue_version++;
+    if (next) {
+      next->ticks += timer->ticks;
+      next->prev_timer = timer->prev_timer;
+    }
+    if (timer->prev_timer) {
+      timer->prev_timer->next_timer = next;
+    } else {
+      timer_queue = next;
+    }
+    timer->next_timer = NULL;
+    timer->prev_timer = NULL;
+    status = ROS_OK;
+  }
+  CRITICAL_END();
+  return status;
+}
+
+#if ROS_TIME_OF_DAY
+static void day_time_advance(uint32_t ticks) {
+  ticks += day_time.ticks;
+  // once a second at most, unless many ticks are announced at once
+  while (ticks >= ROS_SYS_TICK) {
+    ticks -= ROS_SYS_TICK;
+    if (++day_time.second < 60) continue;
+    day_time.second = 0;
+    if (++day_time.minute < 60) continue;
+    day_time.minute = 0;
+    if (++day_time.hour == 24) day_time.hour = 0;
+  }
+  day_time.ticks = ticks;
+}
+#endif
+
+// count the elapsed ticks into the 64 bits tick and the time of day
+static void count_ticks(uint32_t ticks) {
+  uint32_t old = ros_sys_ticks;
+  ros_sys_ticks += ticks;
+  if (ros_sys_ticks < old) ros_sys_ticks_hi++;
+#if ROS_TIME_OF_DAY
+  day_time_advance(ticks);
+#endif
+}
+
 void ros_sys_tick() {
   if (ROS_STARTED) {
-    ros_sys_ticks++;
+    count_ticks(1);
     // check for any delay task is due
     ros_check_timer();
+    ros_time_slice_tick(1);
   } else {
     // #warning "ROS not started, please call ros_init() first."
   }
 }
 
-void ros_set_sys_tick(uint32_t ticks) { ros_sys_ticks = ticks; }
+/**
+ * @brief Announce many ticks at once, when the tick interrupt has been
+ * stopped for a while(tickless idle)
+ * @param  ticks: ticks elapsed since last tick
+ */
+void ros_sys_tick_advance(uint32_t ticks) {
+  if (ROS_STARTED) {
+    count_ticks(ticks);
+    check_timer(ticks);
+    ros_time_slice_tick(ticks);
+  }
+}
+
+/**
+ * @brief Set the low 32 bits of the sys tick, the timers and the time of day
+ * are not affected
+ */
+void ros_set_sys_tick(uint32_t ticks) {
+  CRITICAL_STORE;
+  CRITICAL_START();
+  ros_sys_ticks = ticks;
+  CRITICAL_END();
+}
+
+uint32_t ros_get_sys_tick() {
+  CRITICAL_STORE;
+  uint32_t ticks;
+  // 4 bytes can't be read at once on avr
+  CRITICAL_START();
+  ticks = ros_sys_ticks;
+  CRITICAL_END();
+  return ticks;
+}
 
-uint32_t ros_get_sys_tick() { return ros_sys_ticks; }
+/**
+ * @brief The sys tick extended to 64 bits, it never wraps around in practice
+ */
+uint64_t ros_get_sys_tick64() {
+  CRITICAL_STORE;
+  uint64_t ticks;
+  CRITICAL_START();
+  ticks = (uint64_t)ros_sys_ticks_hi << 32 | ros_sys_ticks;
+  CRITICAL_END();
+  return ticks;
+}
 
+#if ROS_TIME_OF_DAY
+/**
+ * @brief Set the time of day in 24-hours format, it's counted from the sys
+ * tick but setting it doesn't change the sys tick
+ */
 status_t ros_set_time(uint8_t hour, uint8_t minute, uint8_t second) {
-  if (hour < 0 || hour > 23 || minute < 0 || minute > 59 || second < 0 ||
-      second > 59) {
-    return ROS_ERR_PARAM;
-  }
-  ros_sys_ticks = (hour * 3600U + minute * 60U + second) * 100U;
+  CRITICAL_STORE;
+  if (hour > 23 || minute > 59 || second > 59) return ROS_ERR_PARAM;
+  CRITICAL_START();
+  day_time.hour = hour;
+  day_time.minute = minute;
+  day_time.second = second;
+  day_time.ticks = 0;
+  CRITICAL_END();
   return ROS_OK;
 }
 
+/**
+ * @brief Read the time of day as fields, no division and no formatting
+ * @param  *time: the caller provides the storage
+ */
+void ros_get_day_time(ROS_DAY_TIME *time) {
+  CRITICAL_STORE;
+  CRITICAL_START();
+  *time = day_time;
+  CRITICAL_END();
+}
+
+static char *put_2digits(char *str, uint8_t value) {
+  uint8_t tens = 0;
+  while (value >= 10) {
+    value -= 10;
+    tens++;
+  }
+  *str++ = '0' + tens;
+  *str++ = '0' + value;
+  return str;
+}
+
+/**
+ * @brief The time of day as "hh:mm:ss". The string is static, it's overwritten
+ * by the next call: use ros_get_day_time() in more than one task.
+ */
 char *ros_get_time() {
-  uint32_t cur_second = ros_sys_ticks % 8640000U / 100U;
-  uint8_t hour = 0, minute = 0, second = 0;
-  hour = cur_second / 3600U;
-  cur_second %= 3600U;
-  minute = cur_second / 60U;
-  cur_second %= 60U;
-  second = cur_second;
-  sprintf(day_time, "%02d:%02d:%02d", hour, minute, second);
-  return day_time;
-}
\ No newline at end of file
+  ROS_DAY_TIME time;
+  char *str = day_time_str;
+  ros_get_day_time(&time);
+  str = put_2digits(str, time.hour);
+  *str++ = ':';
+  str = put_2digits(str, time.minute);
+  *str++ = ':';
+  str = put_2digits(str, time.second);
+  *str = '\0';
+  return day_time_str;
+}
+#endif
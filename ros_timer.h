@@ -13,20 +13,61 @@ typedef struct ros_tcb ROS_TCB;
 typedef uint8_t status_t;
 
 typedef struct ros_timer {
+  // the task to wake up, NULL for a software timer(ros_soft_timer.h)
   ROS_TCB *blocked_tcb;
+  // ticks to expire, relative to the previous timer once it is registered
   uint32_t ticks;
+  // links in the timer queue, so a timer is removed in O(1)
   struct ros_timer *next_timer;
+  struct ros_timer *prev_timer;
 } ROS_TIMER;
 
+// dec the ticks of timer queue head, wake up tasks of the expired timers
 void ros_check_timer();
-// add the timer to timer queue
+uint32_t ros_timer_next_expiry();
+// add the timer to timer queue, ordered by expiry time
 status_t ros_register_timer(ROS_TIMER *timer);
+status_t ros_unregister_timer(ROS_TIMER *timer);
 status_t ros_delay(uint32_t ticks);
+status_t ros_delay_until(uint32_t *last_wake, uint32_t period);
+void ros_sys_tick_advance(uint32_t ticks);
 void ros_set_sys_tick(uint32_t ticks);
 uint32_t ros_get_sys_tick();
-// transfer system tick to the time in the real world in 24-hours format
+uint64_t ros_get_sys_tick64();
+// microseconds since the os started, define in ros_port.c
+uint64_t ros_time_us();
+
+/**
+ * Wraparound-safe compare of two sys ticks(or any uint32_t time), right as
+ * long as they are less than 2^31 apart: 248 days of 100HZ ticks
+ */
+static inline bool ros_time_before(uint32_t a, uint32_t b) {
+  return (int32_t)(a - b) < 0;
+}
+
+static inline bool ros_time_after(uint32_t a, uint32_t b) {
+  return (int32_t)(a - b) > 0;
+}
+
+// the deadline(a sys tick) has come
+static inline bool ros_deadline_reached(uint32_t deadline) {
+  return !ros_time_before(ros_get_sys_tick(), deadline);
+}
+
+#if ROS_TIME_OF_DAY
+// the time in the real world in 24-hours format, counted by the sys tick
+typedef struct {
+  uint8_t hour;
+  uint8_t minute;
+  uint8_t second;
+  // sys ticks into the second
+  uint16_t ticks;
+} ROS_DAY_TIME;
+
 status_t ros_set_time(uint8_t hour, uint8_t minute, uint8_t second);
-char* ros_get_time();
+void ros_get_day_time(ROS_DAY_TIME *time);
+char *ros_get_time();
+#endif
 
 #ifdef __cplusplus
 }
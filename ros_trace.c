@@ -0,0 +1,94 @@
+// Kernel event trace, a ring buffer in RAM dumped to the host
+#include "ros_trace.h"
+#include "ros.h"
+
+#if ROS_TRACE
+
+ROS_TRACE_RECORD ros_trace_buffer[ROS_TRACE_SIZE];
+// next record to write
+uint8_t ros_trace_head = 0;
+// the ring is full, the oldest record is at ros_trace_head
+bool ros_trace_wrapped = false;
+volatile bool ros_trace_on = true;
+uint16_t ros_trace_stamp_high = 0;
+bool ros_trace_need_stamp = true;
+
+#define TRACE_VERSION 3
+
+/**
+ * @brief Start or stop recording, stop it to keep the records of interest
+ */
+void ros_trace_enable(bool on) { ros_trace_on = on; }
+
+/**
+ * @brief Drop all the records
+ */
+void ros_trace_clear() {
+  CRITICAL_STORE;
+  CRITICAL_START();
+  ros_trace_head = 0;
+  ros_trace_wrapped = false;
+  ros_trace_need_stamp = true;
+  CRITICAL_END();
+}
+
+/**
+ * @brief Record a user event, e.g. to mark where something happens in a task
+ */
+void ros_trace_mark(uint8_t arg) {
+  CRITICAL_STORE;
+  CRITICAL_START();
+  ros_trace_record(ROS_TRACE_MARK, arg);
+  CRITICAL_END();
+}
+
+static void put_u16(void (*put_byte)(uint8_t), uint16_t value) {
+  put_byte(value & 0xFF);
+  put_byte(value >> 8);
+}
+
+static void put_u32(void (*put_byte)(uint8_t), uint32_t value) {
+  put_u16(put_byte, value & 0xFFFF);
+  put_u16(put_byte, value >> 16);
+}
+
+/**
+ * @brief Write the records, from the oldest, through put_byte(e.g. to UART).
+ * Recording is paused while dumping, so put_byte may block. All little endian:
+ * "RT", version, record size, record count(u16), ROS_TIMESTAMP_HZ(u32), trace
+ * time counts per tick(u32), then the records: type, arg, time(u16).
+ * Version 3 writes ROS_TRACE_STAMP only when the high 16 bits of the tick
+ * period time change, version 2 wrote it every tick period.
+ */
+void ros_trace_dump(void (*put_byte)(uint8_t byte)) {
+  CRITICAL_STORE;
+  uint16_t count, i;
+  uint8_t start;
+  bool was_on;
+
+  CRITICAL_START();
+  was_on = ros_trace_on;
+  ros_trace_on = false;
+  count = ros_trace_wrapped ? ROS_TRACE_SIZE : ros_trace_head;
+  start = ros_trace_wrapped ? ros_trace_head : 0;
+  CRITICAL_END();
+
+  put_byte('R');
+  put_byte('T');
+  put_byte(TRACE_VERSION);
+  put_byte(sizeof(ROS_TRACE_RECORD));
+  put_u16(put_byte, count);
+  put_u32(put_byte, ROS_TIMESTAMP_HZ);
+  put_u32(put_byte, ROS_TIMESTAMP_HZ / ROS_SYS_TICK);
+  for (i = 0; i < count; i++) {
+    ROS_TRACE_RECORD *record =
+        &ros_trace_buffer[(uint8_t)(start + i) & (ROS_TRACE_SIZE - 1)];
+    put_byte(record->type);
+    put_byte(record->arg);
+    put_u16(put_byte, record->time);
+  }
+
+  ros_trace_on = was_on;
+}
+
+#endif  // ROS_TRACE
@@ -0,0 +1,108 @@
+#ifndef __ROS_TRACE_H__
+#define __ROS_TRACE_H__
+
+#include "ros_port.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Trace event types, and the arg of the record */
+#define ROS_TRACE_SWITCH 1     // id of the task swapped in
+#define ROS_TRACE_ISR_ENTER 2  // interrupt nesting level
+#define ROS_TRACE_ISR_EXIT 3   // interrupt nesting level
+#define ROS_TRACE_DELAY 4      // delay ticks, 255 if longer
+#define ROS_TRACE_WAKEUP 5     // id of the task woken up
+#define ROS_TRACE_TICK 6       // ticks of the tick period just ended, 255 if
+                               // longer
+#define ROS_TRACE_MARK 7       // user defined, by ros_trace_mark()
+#define ROS_TRACE_STAMP 8      // 0, written right before ROS_TRACE_TICK when
+                               // the high 16 bits of its time change
+
+#if ROS_TRACE
+
+#if ROS_TRACE_SIZE < 2 || ROS_TRACE_SIZE > 256 || \
+    (ROS_TRACE_SIZE & (ROS_TRACE_SIZE - 1))
+#error "ROS_TRACE_SIZE should be a power of 2, 2~256"
+#endif
+
+/**
+ * A trace record, time is ROS_TRACE_TIME() counted from the beginning of the
+ * tick period. A tick period begins with a ROS_TRACE_TICK record instead,
+ * whose time is the low 16 bits of the 32 bits time the period begins at. A
+ * ROS_TRACE_STAMP record with the high 16 bits comes right before it when
+ * they differ from the last period's, about every 65536 counts(1s on avr), or
+ * when recording was paused. So a tick costs one record, the host
+ * tool(tools/ros_trace.py) rebuilds the timeline from them, however long the
+ * period is stretched.
+ */
+typedef struct {
+  uint8_t type;
+  uint8_t arg;
+  uint16_t time;
+} ROS_TRACE_RECORD;
+
+// define in ros_trace.c, the ring overwrites the oldest record when full
+extern ROS_TRACE_RECORD ros_trace_buffer[ROS_TRACE_SIZE];
+extern uint8_t ros_trace_head;
+extern bool ros_trace_wrapped;
+extern volatile bool ros_trace_on;
+// the high 16 bits of the last tick period, and whether the next tick period
+// should write them anyway, as some periods went unrecorded
+extern uint16_t ros_trace_stamp_high;
+extern bool ros_trace_need_stamp;
+
+static inline void ros_trace_put(uint8_t type, uint8_t arg, uint16_t time) {
+  ROS_TRACE_RECORD *record = &ros_trace_buffer[ros_trace_head];
+  record->type = type;
+  record->arg = arg;
+  record->time = time;
+  ros_trace_head = (ros_trace_head + 1) & (ROS_TRACE_SIZE - 1);
+  if (ros_trace_head == 0) ros_trace_wrapped = true;
+}
+
+/**
+ * @brief Record an event, it's called by the kernel with interrupt disabled
+ */
+static inline void ros_trace_record(uint8_t type, uint8_t arg) {
+  if (!ros_trace_on) return;
+  ros_trace_put(type, arg, ROS_TRACE_TIME());
+}
+
+/**
+ * @brief Record the beginning of a tick period, called by the tick ISR with
+ * interrupt disabled, before anything else is recorded in the new period
+ * @param  stamp: the time the period begins at, in ROS_TRACE_TIME() counts
+ * @param  ticks: ticks of the period just ended
+ */
+static inline void ros_trace_tick(uint32_t stamp, uint32_t ticks) {
+  if (!ros_trace_on) {
+    ros_trace_need_stamp = true;
+    return;
+  }
+  if (ros_trace_need_stamp || (stamp >> 16) != ros_trace_stamp_high) {
+    ros_trace_stamp_high = stamp >> 16;
+    ros_trace_need_stamp = false;
+    ros_trace_put(ROS_TRACE_STAMP, 0, ros_trace_stamp_high);
+  }
+  ros_trace_put(ROS_TRACE_TICK, ticks > 0xFF ? 0xFF : ticks, stamp & 0xFFFF);
+}
+
+#define ROS_TRACE_EVENT(type, arg) ros_trace_record(type, arg)
+#define ROS_TRACE_TICK_EVENT(stamp, ticks) ros_trace_tick(stamp, ticks)
+
+void ros_trace_enable(bool on);
+void ros_trace_clear();
+void ros_trace_mark(uint8_t arg);
+void ros_trace_dump(void (*put_byte)(uint8_t byte));
+
+#else
+#define ROS_TRACE_EVENT(type, arg)
+#define ROS_TRACE_TICK_EVENT(stamp, ticks)
+#endif  // ROS_TRACE
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __ROS_TRACE_H__
@@ -0,0 +1,89 @@
+#include "ros_work.h"
+
+#if ROS_WORK_QUEUE
+
+static ROS_TCB work_tcb;
+static uint8_t work_task_stack[ROS_WORK_STACK_SIZE];
+// FIFO of submitted work
+static ROS_WORK *work_head = NULL;
+static ROS_WORK *work_tail = NULL;
+// the work task is blocked for new work, not in a work function
+static bool work_waiting = false;
+
+/**
+ * @brief The work queue task, runs the work in submitted order, and blocks
+ * when there is no work
+ */
+static void work_task() {
+  CRITICAL_STORE;
+  while (1) {
+    CRITICAL_START();
+    ROS_WORK *work = work_head;
+    if (work == NULL) {
+      work_waiting = true;
+      ros_wait(NULL, ROS_WAIT_FOREVER);
+      CRITICAL_END();
+      continue;
+    }
+    work_head = work->next_work;
+    if (work_head == NULL) work_tail = NULL;
+    work->next_work = NULL;
+    // can be submitted again from now on
+    work->pending = false;
+    CRITICAL_END();
+    work->func(work->arg);
+  }
+}
+
+status_t ros_work_start() {
+  return ros_create_task(&work_tcb, work_task, ROS_WORK_PRIORITY,
+                         work_task_stack, ROS_WORK_STACK_SIZE);
+}
+
+/**
+ * @brief init a work item
+ * @param  *work: the caller provides the work storage
+ * @param  func: called by the work queue task
+ * @param  *arg: passed to func
+ * @retval ROS_OK Success
+ * @retval ROS_ERR_PARAM Bad param
+ */
+status_t ros_work_init(ROS_WORK *work, work_func func, void *arg) {
+  if (work == NULL || func == NULL) return ROS_ERR_PARAM;
+  work->func = func;
+  work->arg = arg;
+  work->next_work = NULL;
+  work->pending = false;
+  return ROS_OK;
+}
+
+/**
+ * @brief append the work to the queue, if it's not queued already, and wake up
+ * the work queue task. In ISR the task will be scheduled at ros_int_exit()
+ * @retval ROS_OK Success, or the work is already queued
+ */
+status_t ros_work_submit(ROS_WORK *work) {
+  if (work == NULL) return ROS_ERR_PARAM;
+  CRITICAL_STORE;
+  CRITICAL_START();
+  if (!work->pending) {
+    work->pending = true;
+    work->next_work = NULL;
+    if (work_tail) {
+      work_tail->next_work = work;
+    } else {
+      work_head = work;
+    }
+    work_tail = work;
+    if (work_waiting) {
+      work_waiting = false;
+      ros_wake(&work_tcb, ROS_OK);
+      // no schedule in ISR, until ros_int_exit()
+      ros_schedule();
+    }
+  }
+  CRITICAL_END();
+  return ROS_OK;
+}
+
+#endif  // ROS_WORK_QUEUE
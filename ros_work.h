@@ -0,0 +1,32 @@
+#ifndef __ROS_WORK_H__
+#define __ROS_WORK_H__
+
+#include "ros.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*work_func)(void *arg);
+
+/**
+ * Deferred work item(bottom half). An ISR submits it in O(1) time, and the
+ * work queue task calls func(arg) later, with interrupt enabled. The caller
+ * provides the storage, an item is queued at most once until it runs.
+ */
+typedef struct ros_work {
+  work_func func;
+  void *arg;
+  struct ros_work *next_work;
+  volatile bool pending;
+} ROS_WORK;
+
+status_t ros_work_init(ROS_WORK *work, work_func func, void *arg);
+// safe to call from ISR
+status_t ros_work_submit(ROS_WORK *work);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  //__ROS_WORK_H__
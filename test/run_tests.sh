@@ -0,0 +1,24 @@
+#!/bin/sh
+# Run the host tests, each one is a program printing OK and exiting 0 when
+# every check passes.
+# usage: run_tests.sh test...
+# Exit 1 if any test fails, or doesn't finish in TEST_TIMEOUT(default 60)
+# seconds.
+TIMEOUT=${TEST_TIMEOUT:-60}
+failed=0
+
+for test in "$@"; do
+  output=$(timeout "$TIMEOUT" "$test" 2>&1)
+  status=$?
+  if [ $status -eq 0 ]; then
+    echo "PASS $test"
+  else
+    [ $status -eq 124 ] && output="$output
+timed out after $TIMEOUT seconds"
+    echo "FAIL $test"
+    echo "$output" | sed 's/^/  /'
+    failed=1
+  fi
+done
+
+exit $failed
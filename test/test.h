@@ -0,0 +1,82 @@
+/**
+ * Host tests on the linux port: make PORT=linux test
+ *
+ * Every test_*.c is a program of its own, built with the kernel and run once
+ * ticking and once tickless. The tasks CHECK() the results as they go, one of
+ * them calls test_done() at the end, which prints OK and exits 0, or exits 1
+ * if any check failed. The time is counted in ticks, so the results don't
+ * depend on how busy the host is.
+ */
+#ifndef __ROS_TEST_H__
+#define __ROS_TEST_H__
+
+// ros.h has its own stack_t
+#define stack_t sig_stack_t
+#include <signal.h>
+#undef stack_t
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ros.h"
+
+// printf and the signal handler run on the task stacks
+#define TEST_STACK_SIZE 16384
+
+static int test_fails;
+
+// stdio is not reentrant, so never print with the tick signal unblocked
+#define TEST_PRINT(...)      \
+  do {                       \
+    CRITICAL_STORE;          \
+    CRITICAL_START();        \
+    printf(__VA_ARGS__);     \
+    fflush(stdout);          \
+    CRITICAL_END();          \
+  } while (0)
+
+#define CHECK(cond)                                                  \
+  do {                                                               \
+    if (!(cond)) {                                                   \
+      TEST_PRINT("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);     \
+      test_fails++;                                                  \
+    }                                                                \
+  } while (0)
+
+static inline void test_done() {
+  TEST_PRINT(test_fails ? "FAIL %d checks\n" : "OK\n", test_fails);
+  exit(test_fails ? 1 : 0);
+}
+
+// keep running for some ticks, without giving up the CPU
+static inline void test_spin(uint32_t ticks) {
+  uint32_t start = ros_get_sys_tick();
+  while (ros_get_sys_tick() - start < ticks) {
+  }
+}
+
+/**
+ * @brief SIGUSR1 plays an interrupt, the handler is called like an ISR:
+ * between ros_int_enter() and ros_int_exit(), with the tick signal blocked
+ */
+static void (*test_isr)();
+
+static void test_isr_signal(int sig) {
+  (void)sig;
+  ros_int_enter();
+  test_isr();
+  ros_int_exit();
+}
+
+static inline void test_isr_init(void (*isr)()) {
+  struct sigaction sa;
+  test_isr = isr;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = test_isr_signal;
+  sigemptyset(&sa.sa_mask);
+  sigaddset(&sa.sa_mask, SIGALRM);
+  sigaction(SIGUSR1, &sa, NULL);
+}
+
+static inline void test_isr_raise() { raise(SIGUSR1); }
+
+#endif  // __ROS_TEST_H__
@@ -0,0 +1,123 @@
+/**
+ * Coroutines: many of them sleeping on one host task wake up on time, one
+ * awaits a semaphore with a timeout and a condition, one yields its turns,
+ * all the while started and signaled from another task.
+ */
+#include "test.h"
+#include "ros_coro.h"
+#include "ros_sem.h"
+
+#define BLINKERS 40
+#define BLINKS 10
+#define YIELDS 5
+
+typedef struct {
+  ROS_CORO coro;
+  int id;
+  int count;
+  uint32_t last;
+  int late;
+} BLINKER;
+
+typedef struct {
+  ROS_CORO coro;
+  int got;
+  int timeouts;
+  int yields;
+} WAITER;
+
+BLINKER blinkers[BLINKERS];
+WAITER waiter, yielder;
+ROS_CORO_SCHED sched;
+ROS_SEM sem;
+ROS_TCB host_tcb, control_tcb;
+uint8_t host_stack[TEST_STACK_SIZE], control_stack[TEST_STACK_SIZE];
+volatile bool flag;
+
+static uint32_t blink_ticks(BLINKER *blinker) { return 2 + blinker->id % 3; }
+
+uint8_t blink(ROS_CORO *coro) {
+  BLINKER *blinker = (BLINKER *)coro;
+  ROS_CORO_BEGIN(coro);
+  blinker->last = ros_get_sys_tick();
+  while (blinker->count < BLINKS) {
+    ROS_CORO_DELAY(coro, blink_ticks(blinker));
+    if (ros_get_sys_tick() - blinker->last > blink_ticks(blinker) + 1) {
+      blinker->late++;
+    }
+    blinker->last = ros_get_sys_tick();
+    blinker->count++;
+  }
+  ROS_CORO_END(coro);
+}
+
+uint8_t wait(ROS_CORO *coro) {
+  WAITER *waiter = (WAITER *)coro;
+  ROS_CORO_BEGIN(coro);
+  while (1) {
+    ROS_CORO_AWAIT(coro, ros_sem_take(&sem, ROS_NO_WAIT), 20);
+    if (coro->status == ROS_OK) {
+      waiter->got++;
+    } else {
+      waiter->timeouts++;
+    }
+    ROS_CORO_WAIT_UNTIL(coro, flag, ROS_WAIT_FOREVER);
+    flag = false;
+  }
+  ROS_CORO_END(coro);
+}
+
+uint8_t yield(ROS_CORO *coro) {
+  WAITER *yielder = (WAITER *)coro;
+  ROS_CORO_BEGIN(coro);
+  while (yielder->yields < YIELDS) {
+    yielder->yields++;
+    ROS_CORO_YIELD(coro);
+  }
+  ROS_CORO_EXIT(coro);
+  ROS_CORO_END(coro);
+}
+
+void host_task() { ros_coro_run(&sched); }
+
+void control_task() {
+  int i;
+  for (i = 0; i < BLINKERS; i++) {
+    blinkers[i].id = i;
+    ros_coro_start(&sched, &blinkers[i].coro, blink);
+  }
+  ros_coro_start(&sched, &waiter.coro, wait);
+  ros_coro_start(&sched, &yielder.coro, yield);
+  ros_delay(5);
+  CHECK(yielder.yields == YIELDS && ros_coro_done(&yielder.coro));
+
+  ros_sem_give(&sem);
+  ros_coro_signal(&sched);
+  ros_delay(1);
+  CHECK(waiter.got == 1);
+  ros_delay(3);
+  flag = true;
+  ros_delay(2);
+  CHECK(!flag);
+  // the next await times out
+  ros_delay(25);
+  CHECK(waiter.timeouts == 1);
+
+  ros_delay(20);
+  for (i = 0; i < BLINKERS; i++) {
+    CHECK(blinkers[i].count == BLINKS && blinkers[i].late == 0);
+    CHECK(ros_coro_done(&blinkers[i].coro));
+  }
+  test_done();
+}
+
+int main() {
+  ros_init();
+  ros_sem_init(&sem, 0);
+  ros_coro_sched_init(&sched);
+  ros_create_task(&host_tcb, host_task, 3, host_stack, sizeof(host_stack));
+  ros_create_task(&control_tcb, control_task, 1, control_stack,
+                  sizeof(control_stack));
+  ros_schedule();
+  return 0;
+}
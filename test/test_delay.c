@@ -0,0 +1,40 @@
+/**
+ * Timer delta list: the sleeping tasks of different delays, some expiring at
+ * the same tick, each wake up after exactly the ticks asked for.
+ */
+#include "test.h"
+
+#define DELAY_TASKS 6
+#define DELAY_ROUNDS 5
+
+ROS_TCB delay_tcb[DELAY_TASKS];
+uint8_t delay_stack[DELAY_TASKS][TEST_STACK_SIZE];
+uint32_t delay_ticks[DELAY_TASKS] = {7, 3, 7, 1, 12, 5};
+int delay_done;
+
+void delay_task() {
+  int id = ros_current_tcb() - delay_tcb;
+  int i;
+  for (i = 0; i < DELAY_ROUNDS; i++) {
+    uint32_t start = ros_get_sys_tick();
+    CHECK(ros_delay(delay_ticks[id]) == ROS_OK);
+    CHECK(ros_get_sys_tick() - start == delay_ticks[id]);
+  }
+  if (++delay_done == DELAY_TASKS) {
+    CHECK(ros_delay(0) == ROS_ERR_PARAM);
+    // nothing left in the timer queue
+    CHECK(ros_timer_next_expiry() == UINT32_MAX);
+    test_done();
+  }
+}
+
+int main() {
+  int i;
+  ros_init();
+  for (i = 0; i < DELAY_TASKS; i++) {
+    ros_create_task(&delay_tcb[i], delay_task, i % 3, delay_stack[i],
+                    sizeof(delay_stack[i]));
+  }
+  ros_schedule();
+  return 0;
+}
@@ -0,0 +1,60 @@
+/**
+ * Periodic delay: on time it wakes up every period exactly, late it skips the
+ * missed periods and counts them, a wake up landing on the current tick is a
+ * miss but doesn't block, and the sys tick wraps around.
+ */
+#include "test.h"
+
+#define PERIOD 5
+
+ROS_TCB periodic_tcb;
+uint8_t periodic_stack[TEST_STACK_SIZE];
+
+void periodic_task() {
+  uint32_t last = ros_get_sys_tick();
+  uint32_t start = last;
+  int i;
+  for (i = 0; i < 5; i++) {
+    test_spin(2);
+    CHECK(ros_delay_until(&last, PERIOD) == ROS_OK);
+    CHECK(ros_get_sys_tick() == start + PERIOD * (i + 1));
+  }
+  CHECK(ros_task_deadline_misses(&periodic_tcb) == 0);
+
+  // at 37: the wake ups at 30 and 35 are missed, the next one is at 40
+  test_spin(12);
+  CHECK(ros_delay_until(&last, PERIOD) == ROS_ERR_DEADLINE);
+  CHECK(ros_get_sys_tick() == start + 40 && last == start + 40);
+  CHECK(ros_task_deadline_misses(&periodic_tcb) == 2);
+
+  // two periods late exactly: one period missed, the next one is now
+  ros_set_sys_tick(last + 2 * PERIOD);
+  CHECK(ros_delay_until(&last, PERIOD) == ROS_ERR_DEADLINE);
+  CHECK(last == ros_get_sys_tick());
+  CHECK(ros_task_deadline_misses(&periodic_tcb) == 3);
+
+  // nothing changed if it can't block
+  uint32_t locked_last = last;
+  ros_sched_lock();
+  CHECK(ros_delay_until(&locked_last, PERIOD) == ROS_ERR_CONTEXT);
+  ros_sched_unlock();
+  CHECK(locked_last == last);
+  CHECK(ros_task_deadline_misses(&periodic_tcb) == 3);
+
+  ros_set_sys_tick(UINT32_MAX - 3);
+  last = UINT32_MAX - 3;
+  CHECK(ros_delay_until(&last, 8) == ROS_OK);
+  CHECK(ros_get_sys_tick() == 4 && last == 4);
+  CHECK(ros_delay_until(&last, 8) == ROS_OK);
+  CHECK(ros_get_sys_tick() == 12);
+  CHECK(ros_delay_until(NULL, 8) == ROS_ERR_PARAM);
+  test_done();
+}
+
+int main() {
+  ros_init();
+  ros_create_task(&periodic_tcb, periodic_task, 1, periodic_stack,
+                  sizeof(periodic_stack));
+  ros_schedule();
+  return 0;
+}
@@ -0,0 +1,47 @@
+/**
+ * EDF scheduling(built with ROS_SCHED_EDF): the tasks of one priority woken
+ * up together run earliest deadline first, and a late periodic job counts as
+ * one deadline miss, not once in ros_wait() and again in ros_delay_until().
+ */
+#include "test.h"
+
+ROS_TCB late_tcb, order_tcb[2];
+uint8_t late_stack[TEST_STACK_SIZE], order_stack[2][TEST_STACK_SIZE];
+uint32_t order_deadline[2] = {10, 3};
+char order[3];
+int order_len;
+
+void order_task() {
+  int id = ros_current_tcb() - order_tcb;
+  ros_task_set_deadline(ros_current_tcb(), order_deadline[id]);
+  ros_delay(1);
+  order[order_len++] = '0' + id;
+}
+
+void late_task() {
+  uint32_t last;
+  ros_delay(2);
+  CHECK(strcmp(order, "10") == 0);
+
+  last = ros_get_sys_tick();
+  ros_task_set_deadline(&late_tcb, 5);
+  test_spin(12);
+  CHECK(ros_delay_until(&last, 5) == ROS_ERR_DEADLINE);
+  CHECK(ros_task_deadline_misses(&late_tcb) == 1);
+  CHECK(ros_delay_until(&last, 5) == ROS_OK);
+  CHECK(ros_task_deadline_misses(&late_tcb) == 1);
+  CHECK(ros_task_set_deadline(NULL, 5) == ROS_ERR_PARAM);
+  test_done();
+}
+
+int main() {
+  int i;
+  ros_init();
+  for (i = 0; i < 2; i++) {
+    ros_create_task(&order_tcb[i], order_task, 2, order_stack[i],
+                    sizeof(order_stack[i]));
+  }
+  ros_create_task(&late_tcb, late_task, 1, late_stack, sizeof(late_stack));
+  ros_schedule();
+  return 0;
+}
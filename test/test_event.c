@@ -0,0 +1,69 @@
+/**
+ * Event group: a wait for all the bits and a wait for any of them wake up on
+ * the right set, the clear option clears the bits waited for, and a wait
+ * times out.
+ */
+#include "test.h"
+#include "ros_event.h"
+
+ROS_TCB all_tcb, any_tcb, timeout_tcb, setter_tcb;
+uint8_t all_stack[TEST_STACK_SIZE], any_stack[TEST_STACK_SIZE];
+uint8_t timeout_stack[TEST_STACK_SIZE], setter_stack[TEST_STACK_SIZE];
+ROS_EVENT event;
+volatile bool all_woke, any_woke, timeout_woke;
+
+void all_task() {
+  uint16_t bits;
+  CHECK(ros_event_wait(&event, 0x3, ROS_EVENT_ALL | ROS_EVENT_CLEAR, &bits,
+                       ROS_WAIT_FOREVER) == ROS_OK);
+  CHECK((bits & 0x3) == 0x3);
+  all_woke = true;
+}
+
+void any_task() {
+  uint16_t bits;
+  CHECK(ros_event_wait(&event, 0x6, ROS_EVENT_ANY, &bits, ROS_WAIT_FOREVER) ==
+        ROS_OK);
+  CHECK(bits & 0x6);
+  any_woke = true;
+}
+
+void timeout_task() {
+  uint16_t bits;
+  CHECK(ros_event_wait(&event, 0x10, ROS_EVENT_ANY, &bits, 5) ==
+        ROS_ERR_TIMEOUT);
+  timeout_woke = true;
+}
+
+void setter_task() {
+  uint16_t bits;
+  ros_delay(1);
+  ros_event_set(&event, 0x1);
+  CHECK(!all_woke && !any_woke);
+  ros_delay(1);
+  ros_event_set(&event, 0x2);
+  CHECK(all_woke && any_woke);
+  // cleared by the all waiter
+  CHECK(ros_event_get(&event) == 0);
+  ros_delay(10);
+  CHECK(timeout_woke);
+
+  ros_event_set(&event, 0x8);
+  CHECK(ros_event_wait(&event, 0x8, ROS_EVENT_ANY | ROS_EVENT_CLEAR, &bits,
+                       ROS_NO_WAIT) == ROS_OK);
+  CHECK(ros_event_get(&event) == 0);
+  test_done();
+}
+
+int main() {
+  ros_init();
+  ros_event_init(&event);
+  ros_create_task(&all_tcb, all_task, 1, all_stack, sizeof(all_stack));
+  ros_create_task(&any_tcb, any_task, 2, any_stack, sizeof(any_stack));
+  ros_create_task(&timeout_tcb, timeout_task, 2, timeout_stack,
+                  sizeof(timeout_stack));
+  ros_create_task(&setter_tcb, setter_task, 3, setter_stack,
+                  sizeof(setter_stack));
+  ros_schedule();
+  return 0;
+}
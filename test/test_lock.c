@@ -0,0 +1,83 @@
+/**
+ * Scheduler lock: no other task runs while it's held, not even a higher
+ * priority one made ready or a peer at its time slice, the ticks go on, and
+ * the blocking calls return ROS_ERR_CONTEXT. A task deleting itself with the
+ * lock held releases it.
+ */
+#include "test.h"
+#include "ros_notify.h"
+
+ROS_TCB control_tcb, high_tcb, peer_tcb, self_tcb;
+uint8_t control_stack[TEST_STACK_SIZE], high_stack[TEST_STACK_SIZE];
+uint8_t peer_stack[TEST_STACK_SIZE], self_stack[TEST_STACK_SIZE];
+volatile int high_runs;
+volatile bool after_delete;
+volatile unsigned long spins;
+
+void high_task() {
+  high_runs++;
+  while (1) ros_delay(1000);
+}
+
+void peer_task() {
+  while (1) spins++;
+}
+
+void self_task() {
+  ros_sched_lock();
+  ros_sched_lock();
+  ros_task_delete(NULL);
+  after_delete = true;
+}
+
+void control_task() {
+  uint32_t start;
+  unsigned long count;
+
+  ros_sched_lock();
+  CHECK(ros_sched_locked());
+  ros_create_task(&high_tcb, high_task, 1, high_stack, sizeof(high_stack));
+  start = ros_get_sys_tick();
+  test_spin(3);
+  CHECK(ros_get_sys_tick() - start >= 3);
+  CHECK(high_runs == 0);
+  // nested
+  ros_sched_lock();
+  ros_sched_unlock();
+  CHECK(high_runs == 0);
+  CHECK(ros_delay(1) == ROS_ERR_CONTEXT);
+  CHECK(ros_task_suspend(NULL) == ROS_ERR_CONTEXT);
+  CHECK(ros_notify_take(ROS_WAIT_FOREVER) == ROS_ERR_CONTEXT);
+  CHECK(ros_notify_wait(0, NULL, 5) == ROS_ERR_CONTEXT);
+  CHECK(ros_current_tcb()->notify_state == ROS_NOTIFY_NONE);
+  // the switch held back happens at the unlock
+  ros_sched_unlock();
+  CHECK(high_runs == 1);
+  CHECK(!ros_sched_locked());
+
+  // a peer of the same priority
+  ros_create_task(&peer_tcb, peer_task, 3, peer_stack, sizeof(peer_stack));
+  ros_sched_lock();
+  count = spins;
+  test_spin(5);
+  ros_yield();
+  CHECK(spins == count);
+  ros_sched_unlock();
+  test_spin(3);
+  CHECK(spins != count);
+  ros_task_delete(&peer_tcb);
+
+  ros_create_task(&self_tcb, self_task, 1, self_stack, sizeof(self_stack));
+  CHECK(!after_delete && self_tcb.status == TASK_TERMINATED);
+  CHECK(!ros_sched_locked());
+  test_spin(2);
+  test_done();
+}
+
+int main() {
+  ros_init();
+  ros_create_task(&control_tcb, control_task, 3, control_stack,
+                  sizeof(control_stack));
+  ros_schedule();
+  return 0;
+}
@@ -0,0 +1,71 @@
+/**
+ * Mutex: priority inheritance keeps a middle priority task from preempting
+ * the owner a high priority task waits for, the owner gets its priority back
+ * at the last unlock of a recursive lock, and when the waiter times out.
+ */
+#include "test.h"
+#include "ros_mutex.h"
+
+ROS_TCB low_tcb, mid_tcb, high_tcb, timeout_tcb;
+uint8_t low_stack[TEST_STACK_SIZE], mid_stack[TEST_STACK_SIZE];
+uint8_t high_stack[TEST_STACK_SIZE], timeout_stack[TEST_STACK_SIZE];
+ROS_MUTEX mutex, timeout_mutex;
+volatile bool mid_ran;
+
+void low_task() {
+  CHECK(ros_mutex_lock(&mutex, ROS_WAIT_FOREVER) == ROS_OK);
+  CHECK(ros_mutex_lock(&mutex, ROS_NO_WAIT) == ROS_OK);
+  // the high one blocks on the mutex meanwhile, and lends its priority
+  test_spin(5);
+  CHECK(low_tcb.priority == 1);
+  CHECK(!mid_ran);
+  CHECK(ros_mutex_unlock(&mutex) == ROS_OK);
+  CHECK(low_tcb.priority == 1);
+  CHECK(ros_mutex_unlock(&mutex) == ROS_OK);
+  CHECK(low_tcb.priority == 5);
+}
+
+void mid_task() {
+  ros_delay(2);
+  mid_ran = true;
+}
+
+void high_task() {
+  ros_delay(1);
+  CHECK(ros_mutex_lock(&mutex, ROS_WAIT_FOREVER) == ROS_OK);
+  CHECK(mutex.owner == &high_tcb);
+  CHECK(!mid_ran);
+  CHECK(ros_mutex_unlock(&mutex) == ROS_OK);
+  // not the owner any more
+  CHECK(ros_mutex_unlock(&mutex) == ROS_ERROR);
+
+  ros_delay(10);
+  CHECK(ros_mutex_lock(&timeout_mutex, 3) == ROS_ERR_TIMEOUT);
+  CHECK(timeout_tcb.priority == 6);
+}
+
+void timeout_task() {
+  ros_delay(8);
+  CHECK(ros_mutex_lock(&timeout_mutex, ROS_NO_WAIT) == ROS_OK);
+  test_spin(2);
+  CHECK(timeout_tcb.priority == 1);
+  // the high one gave up waiting
+  test_spin(3);
+  CHECK(timeout_tcb.priority == 6);
+  CHECK(ros_mutex_unlock(&timeout_mutex) == ROS_OK);
+  ros_delay(3);
+  test_done();
+}
+
+int main() {
+  ros_init();
+  ros_mutex_init(&mutex);
+  ros_mutex_init(&timeout_mutex);
+  ros_create_task(&low_tcb, low_task, 5, low_stack, sizeof(low_stack));
+  ros_create_task(&mid_tcb, mid_task, 3, mid_stack, sizeof(mid_stack));
+  ros_create_task(&high_tcb, high_task, 1, high_stack, sizeof(high_stack));
+  ros_create_task(&timeout_tcb, timeout_task, 6, timeout_stack,
+                  sizeof(timeout_stack));
+  ros_schedule();
+  return 0;
+}
@@ -0,0 +1,57 @@
+/**
+ * Task notification: a wait times out, then gets an overwritten value, bits
+ * set together, and counts taken one by one. A value not taken yet is not
+ * overwritten by ROS_NOTIFY_NO_OVERWRITE.
+ */
+#include "test.h"
+#include "ros_notify.h"
+
+ROS_TCB rx_tcb, tx_tcb;
+uint8_t rx_stack[TEST_STACK_SIZE], tx_stack[TEST_STACK_SIZE];
+volatile bool rx_done;
+
+void rx_task() {
+  uint32_t value;
+  int i;
+  CHECK(ros_notify_wait(0, &value, 3) == ROS_ERR_TIMEOUT);
+  CHECK(ros_notify_wait(UINT32_MAX, &value, ROS_WAIT_FOREVER) == ROS_OK);
+  CHECK(value == 42);
+  CHECK(ros_notify_wait(UINT32_MAX, &value, ROS_WAIT_FOREVER) == ROS_OK);
+  CHECK(value == 0x5);
+  for (i = 0; i < 3; i++) CHECK(ros_notify_take(ROS_WAIT_FOREVER) == ROS_OK);
+  CHECK(ros_notify_take(ROS_NO_WAIT) == ROS_ERR_TIMEOUT);
+  rx_done = true;
+  while (1) ros_delay(100);
+}
+
+void tx_task() {
+  ros_delay(10);
+  CHECK(ros_notify(&rx_tcb, 42, ROS_NOTIFY_OVERWRITE) == ROS_OK);
+  ros_delay(2);
+  {
+    // both bits before the receiver runs
+    CRITICAL_STORE;
+    CRITICAL_START();
+    ros_notify(&rx_tcb, 0x1, ROS_NOTIFY_SET_BITS);
+    ros_notify(&rx_tcb, 0x4, ROS_NOTIFY_SET_BITS);
+    CRITICAL_END();
+  }
+  ros_delay(2);
+  ros_notify(&rx_tcb, 0, ROS_NOTIFY_INCREMENT);
+  ros_notify(&rx_tcb, 0, ROS_NOTIFY_INCREMENT);
+  ros_notify(&rx_tcb, 0, ROS_NOTIFY_INCREMENT);
+  ros_delay(5);
+  CHECK(rx_done);
+
+  CHECK(ros_notify(&rx_tcb, 7, ROS_NOTIFY_OVERWRITE) == ROS_OK);
+  CHECK(ros_notify(&rx_tcb, 8, ROS_NOTIFY_NO_OVERWRITE) == ROS_ERR_FULL);
+  test_done();
+}
+
+int main() {
+  ros_init();
+  ros_create_task(&rx_tcb, rx_task, 1, rx_stack, sizeof(rx_stack));
+  ros_create_task(&tx_tcb, tx_task, 0, tx_stack, sizeof(tx_stack));
+  ros_schedule();
+  return 0;
+}
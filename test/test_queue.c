@@ -0,0 +1,94 @@
+/**
+ * Message queue: items come out in order through a queue much shorter than
+ * the stream, a full send and an empty receive time out, an ISR sends to a
+ * single producer queue, and pointers pass by reference.
+ */
+#include "test.h"
+#include "ros_queue.h"
+
+#define STREAM_ITEMS 100
+#define ISR_ITEMS 20
+
+ROS_TCB producer_tcb, consumer_tcb, ptr_tcb;
+uint8_t producer_stack[TEST_STACK_SIZE], consumer_stack[TEST_STACK_SIZE];
+uint8_t ptr_stack[TEST_STACK_SIZE];
+ROS_QUEUE queue, isr_queue, ptr_queue;
+uint8_t queue_buffer[ROS_QUEUE_BUFFER_SIZE(sizeof(uint32_t), 3)];
+uint8_t isr_queue_buffer[ROS_QUEUE_BUFFER_SIZE(sizeof(uint16_t), 8)];
+uint8_t ptr_queue_buffer[ROS_QUEUE_BUFFER_SIZE(sizeof(void *), 2)];
+uint16_t isr_value;
+volatile bool consumer_done, ptr_done;
+
+static void send_isr() {
+  ros_queue_send_isr(&isr_queue, &isr_value);
+  isr_value++;
+}
+
+void producer_task() {
+  uint32_t i, value = 7;
+  for (i = 0; i < STREAM_ITEMS; i++) {
+    CHECK(ros_queue_send(&queue, &i, ROS_WAIT_FOREVER) == ROS_OK);
+  }
+  ros_delay(5);
+
+  for (i = 0; i < 3; i++) ros_queue_send(&queue, &value, ROS_NO_WAIT);
+  uint32_t start = ros_get_sys_tick();
+  CHECK(ros_queue_send(&queue, &value, 4) == ROS_ERR_TIMEOUT);
+  CHECK(ros_get_sys_tick() - start == 4);
+  CHECK(ros_queue_count(&queue) == 3);
+  for (i = 0; i < 3; i++) {
+    CHECK(ros_queue_recv(&queue, &value, ROS_NO_WAIT) == ROS_OK);
+  }
+  CHECK(ros_queue_recv(&queue, &value, ROS_NO_WAIT) == ROS_ERR_TIMEOUT);
+
+  test_isr_init(send_isr);
+  for (i = 0; i < ISR_ITEMS; i++) {
+    test_isr_raise();
+    if (i % 5 == 0) ros_delay(1);
+  }
+
+  static char text[] = "hello";
+  CHECK(ros_queue_send_ptr(&ptr_queue, text, ROS_NO_WAIT) == ROS_OK);
+  ros_delay(5);
+  CHECK(consumer_done && ptr_done);
+  test_done();
+}
+
+void consumer_task() {
+  uint32_t i, value;
+  uint16_t isr_item;
+  for (i = 0; i < STREAM_ITEMS; i++) {
+    CHECK(ros_queue_recv(&queue, &value, ROS_WAIT_FOREVER) == ROS_OK);
+    CHECK(value == i);
+    if (i % 17 == 0) ros_delay(1);
+  }
+  for (i = 0; i < ISR_ITEMS; i++) {
+    CHECK(ros_queue_recv(&isr_queue, &isr_item, 50) == ROS_OK);
+    CHECK(isr_item == i);
+  }
+  consumer_done = true;
+}
+
+void ptr_task() {
+  void *ptr;
+  CHECK(ros_queue_recv_ptr(&ptr_queue, &ptr, ROS_WAIT_FOREVER) == ROS_OK);
+  CHECK(strcmp(ptr, "hello") == 0);
+  ptr_done = true;
+}
+
+int main() {
+  ros_init();
+  CHECK(ros_queue_init(&queue, queue_buffer, sizeof(uint32_t), 0, 0) ==
+        ROS_ERR_PARAM);
+  ros_queue_init(&queue, queue_buffer, sizeof(uint32_t), 3, 0);
+  ros_queue_init(&isr_queue, isr_queue_buffer, sizeof(uint16_t), 8,
+                 ROS_QUEUE_SPSC);
+  ros_queue_init(&ptr_queue, ptr_queue_buffer, sizeof(void *), 2, 0);
+  ros_create_task(&producer_tcb, producer_task, 3, producer_stack,
+                  sizeof(producer_stack));
+  ros_create_task(&consumer_tcb, consumer_task, 2, consumer_stack,
+                  sizeof(consumer_stack));
+  ros_create_task(&ptr_tcb, ptr_task, 1, ptr_stack, sizeof(ptr_stack));
+  ros_schedule();
+  return 0;
+}
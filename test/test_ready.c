@@ -0,0 +1,68 @@
+/**
+ * Ready queue: the highest priority runs first, first come first served
+ * within a priority, and the tasks of one priority share the CPU by time
+ * slices.
+ */
+#include "test.h"
+
+#define ORDER_TASKS 5
+
+ROS_TCB order_tcb[ORDER_TASKS];
+uint8_t order_stack[ORDER_TASKS][TEST_STACK_SIZE];
+uint8_t order_priority[ORDER_TASKS] = {3, 1, 6, 1, 0};
+char order[2 * ORDER_TASKS + 1];
+int order_len;
+uint32_t wake_tick;
+
+ROS_TCB spin_tcb[2], check_tcb, bad_tcb;
+uint8_t spin_stack[2][TEST_STACK_SIZE], check_stack[TEST_STACK_SIZE];
+uint8_t bad_stack[TEST_STACK_SIZE];
+volatile unsigned long spins[2];
+
+void order_task() {
+  char id = '0' + (ros_current_tcb() - order_tcb);
+  order[order_len++] = id;
+  // all of them wake up at the same tick, however late the host runs them
+  ros_delay(wake_tick - ros_get_sys_tick());
+  order[order_len++] = id;
+}
+
+void spin_task() {
+  int id = ros_current_tcb() - spin_tcb;
+  while (1) spins[id]++;
+}
+
+void check_task() {
+  ros_delay(wake_tick + 1 - ros_get_sys_tick());
+  CHECK(strcmp(order, "4130241302") == 0);
+
+  CHECK(ros_create_task(&bad_tcb, spin_task, MIN_TASK_PRIORITY + 1, bad_stack,
+                        sizeof(bad_stack)) == ROS_ERR_PARAM);
+  CHECK(ros_create_task(NULL, spin_task, 1, bad_stack, sizeof(bad_stack)) ==
+        ROS_ERR_PARAM);
+
+  // two spinning tasks of one priority, both get their time slices
+  ros_create_task(&spin_tcb[0], spin_task, 3, spin_stack[0],
+                  sizeof(spin_stack[0]));
+  ros_create_task(&spin_tcb[1], spin_task, 3, spin_stack[1],
+                  sizeof(spin_stack[1]));
+  ros_delay(20);
+  CHECK(spins[0] > 0 && spins[1] > 0);
+  CHECK(spin_tcb[0].switch_count > 1 && spin_tcb[1].switch_count > 1);
+  test_done();
+}
+
+int main() {
+  int i;
+  ros_init();
+  for (i = 0; i < ORDER_TASKS; i++) {
+    ros_create_task(&order_tcb[i], order_task, order_priority[i],
+                    order_stack[i], sizeof(order_stack[i]));
+  }
+  // above the spinning tasks
+  ros_create_task(&check_tcb, check_task, 2, check_stack,
+                  sizeof(check_stack));
+  wake_tick = ros_get_sys_tick() + 10;
+  ros_schedule();
+  return 0;
+}
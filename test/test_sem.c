@@ -0,0 +1,74 @@
+/**
+ * Semaphore: the waiters are woken up highest priority first, a give from an
+ * ISR wakes a waiter, and a take times out after exactly its ticks.
+ */
+#include "test.h"
+#include "ros_sem.h"
+
+#define WAITERS 3
+
+ROS_TCB waiter_tcb[WAITERS], isr_tcb, giver_tcb;
+uint8_t waiter_stack[WAITERS][TEST_STACK_SIZE];
+uint8_t isr_stack[TEST_STACK_SIZE], giver_stack[TEST_STACK_SIZE];
+uint8_t waiter_priority[WAITERS] = {3, 1, 2};
+ROS_SEM sem, isr_sem;
+char order[WAITERS + 1];
+int order_len;
+bool isr_done;
+
+static void give_isr() { ros_sem_give(&isr_sem); }
+
+void waiter_task() {
+  CHECK(ros_sem_take(&sem, ROS_WAIT_FOREVER) == ROS_OK);
+  order[order_len++] = '0' + (ros_current_tcb() - waiter_tcb);
+}
+
+void isr_task() {
+  uint32_t start = ros_get_sys_tick();
+  CHECK(ros_sem_take(&isr_sem, 50) == ROS_OK);
+  CHECK(ros_get_sys_tick() - start < 10);
+  start = ros_get_sys_tick();
+  CHECK(ros_sem_take(&isr_sem, 7) == ROS_ERR_TIMEOUT);
+  CHECK(ros_get_sys_tick() - start == 7);
+  CHECK(ros_sem_take(&isr_sem, ROS_NO_WAIT) == ROS_ERR_TIMEOUT);
+  isr_done = true;
+}
+
+void giver_task() {
+  int i;
+  // all the waiters are blocked
+  ros_delay(2);
+  for (i = 0; i < WAITERS; i++) CHECK(ros_sem_give(&sem) == ROS_OK);
+  ros_delay(2);
+  CHECK(strcmp(order, "120") == 0);
+
+  test_isr_init(give_isr);
+  test_isr_raise();
+  ros_delay(20);
+  CHECK(isr_done);
+
+  // nobody waiting, the count goes up
+  ros_sem_give(&sem);
+  ros_sem_give(&sem);
+  CHECK(sem.count == 2);
+  CHECK(ros_sem_take(&sem, ROS_NO_WAIT) == ROS_OK);
+  CHECK(sem.count == 1);
+  CHECK(ros_sem_init(NULL, 0) == ROS_ERR_PARAM);
+  test_done();
+}
+
+int main() {
+  int i;
+  ros_init();
+  ros_sem_init(&sem, 0);
+  ros_sem_init(&isr_sem, 0);
+  for (i = 0; i < WAITERS; i++) {
+    ros_create_task(&waiter_tcb[i], waiter_task, waiter_priority[i],
+                    waiter_stack[i], sizeof(waiter_stack[i]));
+  }
+  ros_create_task(&isr_tcb, isr_task, 4, isr_stack, sizeof(isr_stack));
+  ros_create_task(&giver_tcb, giver_task, 5, giver_stack,
+                  sizeof(giver_stack));
+  ros_schedule();
+  return 0;
+}
@@ -0,0 +1,41 @@
+/**
+ * Time slices: a task runs its whole slice before a peer woken up meanwhile
+ * takes over, also right after a ros_yield() nobody took over.
+ */
+#include "test.h"
+
+#define SLICE 5
+
+ROS_TCB spin_tcb, peer_tcb;
+uint8_t spin_stack[TEST_STACK_SIZE], peer_stack[TEST_STACK_SIZE];
+volatile bool peer_ran;
+
+void peer_task() {
+  ros_delay(2);
+  peer_ran = true;
+}
+
+void spin_task() {
+  uint32_t start;
+  CHECK(ros_task_set_time_slice(NULL, SLICE) == ROS_ERR_PARAM);
+  ros_task_set_time_slice(&spin_tcb, SLICE);
+  // the peer is sleeping, the yield starts a new slice
+  ros_yield();
+  start = ros_get_sys_tick();
+  // the peer is ready from the second tick on
+  while (ros_get_sys_tick() - start < SLICE - 1) {
+  }
+  CHECK(!peer_ran);
+  while (ros_get_sys_tick() - start < SLICE + 2) {
+  }
+  CHECK(peer_ran);
+  test_done();
+}
+
+int main() {
+  ros_init();
+  ros_create_task(&peer_tcb, peer_task, 3, peer_stack, sizeof(peer_stack));
+  ros_create_task(&spin_tcb, spin_task, 3, spin_stack, sizeof(spin_stack));
+  ros_schedule();
+  return 0;
+}
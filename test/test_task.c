@@ -0,0 +1,125 @@
+/**
+ * Suspend, resume and delete: a suspended waiter doesn't time out until
+ * resumed, a suspended task doesn't run, a deleted task leaves no timer
+ * behind and its storage can be reused, and deleting a mutex waiter gives the
+ * owner its own priority back.
+ */
+#include "test.h"
+#include "ros_mutex.h"
+#include "ros_sem.h"
+
+ROS_TCB control_tcb, waiter_tcb, spin_tcb, blocked_tcb, owner_tcb, lock_tcb;
+uint8_t control_stack[TEST_STACK_SIZE], waiter_stack[TEST_STACK_SIZE];
+uint8_t spin_stack[TEST_STACK_SIZE], blocked_stack[TEST_STACK_SIZE];
+uint8_t owner_stack[TEST_STACK_SIZE], lock_stack[TEST_STACK_SIZE];
+ROS_SEM sem;
+ROS_MUTEX mutex;
+volatile int waiter_status = -1;
+volatile bool reused, after_delete;
+volatile unsigned long spins;
+
+void waiter_task() {
+  waiter_status = ros_sem_take(&sem, 1000);
+  while (1) ros_delay(1000);
+}
+
+void spin_task() {
+  while (1) spins++;
+}
+
+void blocked_task() {
+  ros_sem_take(&sem, 50);
+  // deleted before the timeout
+  CHECK(false);
+}
+
+void reuse_task() {
+  reused = true;
+  ros_task_delete(NULL);
+  after_delete = true;
+}
+
+void owner_task() {
+  ros_mutex_lock(&mutex, ROS_WAIT_FOREVER);
+  while (1) ros_delay(1000);
+}
+
+void lock_task() {
+  ros_mutex_lock(&mutex, ROS_WAIT_FOREVER);
+  // deleted while waiting
+  CHECK(false);
+}
+
+void control_task() {
+  ROS_TCB *tcb;
+  unsigned long count;
+  int found = 0;
+
+  ros_create_task(&waiter_tcb, waiter_task, 1, waiter_stack,
+                  sizeof(waiter_stack));
+  ros_create_task(&spin_tcb, spin_task, 5, spin_stack, sizeof(spin_stack));
+  ros_create_task(&blocked_tcb, blocked_task, 1, blocked_stack,
+                  sizeof(blocked_stack));
+  ros_delay(2);
+  CHECK(ros_timer_next_expiry() <= 50);
+
+  // a blocked task, its timeout is held until resumed
+  CHECK(ros_task_suspend(&waiter_tcb) == ROS_OK);
+  CHECK(waiter_tcb.status == TASK_SUSPENDED);
+  ros_delay(3);
+  CHECK(waiter_status == -1);
+  CHECK(ros_task_resume(&waiter_tcb) == ROS_OK);
+  ros_delay(1);
+  CHECK(waiter_status == ROS_ERR_TIMEOUT);
+  CHECK(ros_task_resume(&waiter_tcb) == ROS_ERR_PARAM);
+
+  // a ready task
+  ros_delay(3);
+  CHECK(spins > 0);
+  CHECK(ros_task_suspend(&spin_tcb) == ROS_OK);
+  count = spins;
+  ros_delay(5);
+  CHECK(spins == count);
+  ros_task_resume(&spin_tcb);
+  ros_delay(5);
+  CHECK(spins != count);
+  CHECK(ros_task_delete(&spin_tcb) == ROS_OK);
+  count = spins;
+  ros_delay(5);
+  CHECK(spins == count);
+
+  // a blocked task, its storage reused after its timeout would have fired
+  CHECK(ros_task_delete(&blocked_tcb) == ROS_OK);
+  ros_delay(60);
+  CHECK(ros_create_task(&blocked_tcb, reuse_task, 1, blocked_stack,
+                        sizeof(blocked_stack)) == ROS_OK);
+  ros_delay(1);
+  CHECK(reused && !after_delete);
+  CHECK(blocked_tcb.status == TASK_TERMINATED);
+  for (tcb = ros_task_next(NULL); tcb; tcb = ros_task_next(tcb)) {
+    if (tcb == &blocked_tcb) found++;
+  }
+  CHECK(found == 0);
+
+  // a mutex waiter
+  ros_create_task(&owner_tcb, owner_task, 6, owner_stack, sizeof(owner_stack));
+  ros_delay(2);
+  ros_create_task(&lock_tcb, lock_task, 2, lock_stack, sizeof(lock_stack));
+  ros_delay(1);
+  CHECK(owner_tcb.priority == 2);
+  CHECK(ros_task_delete(&lock_tcb) == ROS_OK);
+  CHECK(owner_tcb.priority == 6);
+  // it holds a mutex
+  CHECK(ros_task_delete(&owner_tcb) == ROS_ERROR);
+  test_done();
+}
+
+int main() {
+  ros_init();
+  ros_sem_init(&sem, 0);
+  ros_mutex_init(&mutex);
+  ros_create_task(&control_tcb, control_task, 0, control_stack,
+                  sizeof(control_stack));
+  ros_schedule();
+  return 0;
+}
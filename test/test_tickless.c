@@ -0,0 +1,75 @@
+/**
+ * Tickless idle: a period stretched over many ticks announces them all, and
+ * an interrupt in the middle of it ends it with the ticks elapsed so far.
+ * Built ticking as well, where the same results come tick by tick.
+ */
+#include <time.h>
+#include "test.h"
+#include "ros_sem.h"
+
+#define LONG_DELAY 70
+#define PEER_DELAY 33
+// the interrupt comes in the middle of a tick period
+#define ISR_USEC 255000L
+#define ISR_TICKS (ISR_USEC * ROS_SYS_TICK / 1000000L)
+
+ROS_TCB sleeper_tcb, peer_tcb;
+uint8_t sleeper_stack[TEST_STACK_SIZE], peer_stack[TEST_STACK_SIZE];
+ROS_SEM isr_sem;
+timer_t isr_timer;
+uint32_t peer_wakes;
+
+static void sem_isr() { ros_sem_give(&isr_sem); }
+
+static void isr_timer_start(long usec) {
+  struct sigevent event;
+  struct itimerspec spec;
+  memset(&event, 0, sizeof(event));
+  event.sigev_notify = SIGEV_SIGNAL;
+  event.sigev_signo = SIGUSR1;
+  timer_create(CLOCK_MONOTONIC, &event, &isr_timer);
+  memset(&spec, 0, sizeof(spec));
+  spec.it_value.tv_sec = usec / 1000000L;
+  spec.it_value.tv_nsec = usec % 1000000L * 1000L;
+  timer_settime(isr_timer, 0, &spec, NULL);
+}
+
+void peer_task() {
+  while (1) {
+    ros_delay(PEER_DELAY);
+    peer_wakes++;
+  }
+}
+
+void sleeper_task() {
+  int i;
+  uint32_t start = ros_get_sys_tick();
+  for (i = 0; i < 3; i++) CHECK(ros_delay(LONG_DELAY) == ROS_OK);
+  CHECK(ros_get_sys_tick() - start == 3 * LONG_DELAY);
+  CHECK(peer_wakes == 3 * LONG_DELAY / PEER_DELAY);
+
+  // woken up by the interrupt long before the timeout
+  ros_task_delete(&peer_tcb);
+  test_isr_init(sem_isr);
+  start = ros_get_sys_tick();
+  isr_timer_start(ISR_USEC);
+  CHECK(ros_sem_take(&isr_sem, 4 * ISR_TICKS) == ROS_OK);
+  // the host may run late, or drop ticks when ticking, so no exact count
+  uint32_t ticks = ros_get_sys_tick() - start;
+  CHECK(ticks > 0 && ticks < 4 * ISR_TICKS);
+  // and ticking right again
+  start = ros_get_sys_tick();
+  CHECK(ros_delay(5) == ROS_OK);
+  CHECK(ros_get_sys_tick() - start == 5);
+  test_done();
+}
+
+int main() {
+  ros_init();
+  ros_sem_init(&isr_sem, 0);
+  ros_create_task(&sleeper_tcb, sleeper_task, 1, sleeper_stack,
+                  sizeof(sleeper_stack));
+  ros_create_task(&peer_tcb, peer_task, 2, peer_stack, sizeof(peer_stack));
+  ros_schedule();
+  return 0;
+}
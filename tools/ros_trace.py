@@ -0,0 +1,171 @@
+#!/usr/bin/env python3
+"""Convert a ROS trace dump(ros_trace_dump()) to Chrome trace JSON.
+
+Open the output in chrome://tracing or https://ui.perfetto.dev
+
+    python3 tools/ros_trace.py dump.bin -o trace.json --names 0=idle,2=t1
+"""
+import argparse
+import json
+import struct
+import sys
+
+SWITCH, ISR_ENTER, ISR_EXIT, DELAY, WAKEUP, TICK, MARK, STAMP = range(1, 9)
+ISR_TID = 1000
+
+
+def read_dump(data):
+    magic, version, record_size, count, hz, tick_counts = struct.unpack_from(
+        "<2sBBHII", data)
+    if magic != b"RT" or version not in (2, 3) or record_size != 4:
+        raise ValueError("not a ROS trace dump")
+    records = [struct.unpack_from("<BBH", data, 14 + i * 4) for i in range(count)]
+    return hz, tick_counts, records
+
+
+def timeline(records, tick_counts):
+    """Yield (time in counts, type, arg). The record time restarts from 0 at
+    every tick period, a period begins at the TICK record, which carries the
+    low 16 bits of the 32 bits time it begins at. A STAMP record right before
+    it carries the high 16 bits when they differ from the last period's."""
+    base = None
+    # the last period's low and high 16 bits, high is None until a STAMP
+    low = None
+    high = None
+    stamp = None
+    last = 0
+    # records waiting for the next TICK: those before the first one, and
+    # those an ISR records in the new period before the TICK record
+    pending = []
+    for record in records:
+        type_, arg, time = record
+        if type_ == STAMP:
+            stamp = time
+            continue
+        if type_ == TICK:
+            if base is None:
+                # the records before are in the period just ended
+                base = max([tick_counts] + [t + 1 for _, _, t in pending])
+                for type0, arg0, time0 in pending:
+                    yield time0, type0, arg0
+                pending = []
+            else:
+                delta = (time - low) & 0xFFFF
+                if stamp is not None and high is not None:
+                    # the stamp wraps around in 32 bits
+                    delta = ((stamp << 16 | time) -
+                             (high << 16 | low)) & 0xFFFFFFFF
+                elif stamp is not None:
+                    # the ring starts after the last STAMP, guess the
+                    # 65536 counts wrapped from the ticks of the period
+                    delta += max(0, round((arg * tick_counts - delta) /
+                                          65536.0)) * 65536
+                # without a STAMP the high 16 bits are the same
+                base += delta
+            if stamp is not None:
+                high = stamp
+            low = time
+            stamp = None
+            yield base, TICK, arg
+            last = 0
+            for type0, arg0, time0 in pending:
+                yield base + time0, type0, arg0
+                last = time0
+            pending = []
+        elif base is None or pending or time < last:
+            pending.append(record)
+        else:
+            last = time
+            yield base + time, type_, arg
+    # the last period is cut off before its TICK record
+    for type_, arg, time in pending:
+        yield (base or 0) + time, type_, arg
+
+
+def convert(hz, tick_counts, records, names):
+    events = []
+    running = None
+    isr_depth = 0
+
+    def us(t):
+        return t * 1000000.0 / hz
+
+    def task_name(tid):
+        return names.get(tid, "task %d" % tid)
+
+    seen = set()
+    for t, type_, arg in timeline(records, tick_counts):
+        ts = us(t)
+        if type_ == SWITCH:
+            if running is not None:
+                events.append({"name": task_name(running), "ph": "E",
+                               "ts": ts, "pid": 0, "tid": running})
+            running = arg
+            seen.add(arg)
+            events.append({"name": task_name(arg), "ph": "B", "ts": ts,
+                           "pid": 0, "tid": arg})
+        elif type_ == ISR_ENTER:
+            isr_depth += 1
+            events.append({"name": "isr", "ph": "B", "ts": ts, "pid": 0,
+                           "tid": ISR_TID})
+        elif type_ == ISR_EXIT:
+            # the ring may start in the middle of an ISR
+            if isr_depth:
+                isr_depth -= 1
+                events.append({"name": "isr", "ph": "E", "ts": ts, "pid": 0,
+                               "tid": ISR_TID})
+        elif type_ == DELAY and running is not None:
+            events.append({"name": "delay", "ph": "i", "s": "t", "ts": ts,
+                           "pid": 0, "tid": running, "args": {"ticks": arg}})
+        elif type_ == WAKEUP:
+            seen.add(arg)
+            events.append({"name": "wakeup", "ph": "i", "s": "t", "ts": ts,
+                           "pid": 0, "tid": arg})
+        elif type_ == TICK:
+            events.append({"name": "tick", "ph": "i", "s": "t", "ts": ts,
+                           "pid": 0, "tid": ISR_TID, "args": {"ticks": arg}})
+        elif type_ == MARK:
+            events.append({"name": "mark %d" % arg, "ph": "i", "s": "t",
+                           "ts": ts, "pid": 0,
+                           "tid": running if running is not None else ISR_TID})
+
+    for tid in sorted(seen):
+        events.append({"name": "thread_name", "ph": "M", "pid": 0, "tid": tid,
+                       "args": {"name": task_name(tid)}})
+    events.append({"name": "thread_name", "ph": "M", "pid": 0, "tid": ISR_TID,
+                   "args": {"name": "interrupts"}})
+    return {"traceEvents": events, "displayTimeUnit": "ms"}
+
+
+def parse_names(text):
+    names = {}
+    for item in filter(None, (text or "").split(",")):
+        tid, name = item.split("=", 1)
+        names[int(tid)] = name
+    names.setdefault(0, "idle")
+    return names
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("dump", help="binary dump, - for stdin")
+    parser.add_argument("-o", "--output", help="JSON file, default stdout")
+    parser.add_argument("--names", help="task names by trace id: 1=work,2=t1")
+    args = parser.parse_args()
+
+    if args.dump == "-":
+        data = sys.stdin.buffer.read()
+    else:
+        with open(args.dump, "rb") as f:
+            data = f.read()
+    hz, tick_counts, records = read_dump(data)
+    trace = convert(hz, tick_counts, records, parse_names(args.names))
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(trace, f)
+    else:
+        json.dump(trace, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()